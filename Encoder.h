@@ -42,11 +42,24 @@
 
 #if defined(ENCODER_USE_INTERRUPTS) || !defined(ENCODER_DO_NOT_USE_INTERRUPTS)
 #define ENCODER_USE_INTERRUPTS
+// Some cores can pass a pointer to the interrupt function, so each
+// encoder's state goes straight to update(), without the table of
+// interruptArgs and one isrN function per interrupt.  ESP8266 has
+// attachInterruptArg since version 2.5.0, so define this manually.
+#if !defined(ENCODER_USE_INTERRUPT_ARG) && (defined(ESP32) || \
+  (defined(ARDUINO_ARCH_RP2040) && !defined(ARDUINO_ARCH_MBED)))
+#define ENCODER_USE_INTERRUPT_ARG
+#endif
+#ifdef ENCODER_USE_INTERRUPT_ARG
+#undef ENCODER_OPTIMIZE_INTERRUPTS
+#define ENCODER_ARGLIST_SIZE 0
+#else
 #define ENCODER_ARGLIST_SIZE CORE_NUM_INTERRUPT
 #include "utility/interrupt_pins.h"
 #ifdef ENCODER_OPTIMIZE_INTERRUPTS
 #include "utility/interrupt_config.h"
 #endif
+#endif
 #else
 #define ENCODER_ARGLIST_SIZE 0
 #endif
@@ -60,6 +73,245 @@
 #define IRAM_ATTR
 #endif
 
+// ESP32 also needs constant data used by interrupts placed in RAM, since
+// flash may be unavailable (eg, during writes) when an interrupt occurs
+#if defined(ESP32)
+#define ENCODER_ISR_DATA DRAM_ATTR
+#else
+#define ENCODER_ISR_DATA
+#endif
+
+// On 32 bit processors with atomic exchange (ARM Cortex-M3 and up, ESP32)
+// the position can be read, written and reset without disabling
+// interrupts, whenever both pins have interrupts.  Cortex-M0, ESP8266
+// and 8 bit AVR lack the instructions, so they keep noInterrupts().
+// So does an index pin with 64 bit positions, since an index reset
+// must be seen together with the position.
+#if defined(ENCODER_USE_INTERRUPTS) && !defined(__AVR__) && \
+  !(defined(ENCODER_USE_INDEX) && defined(ENCODER_USE_64BIT_POSITION)) && \
+  defined(__GCC_ATOMIC_INT_LOCK_FREE) && __GCC_ATOMIC_INT_LOCK_FREE == 2 && \
+  __SIZEOF_INT__ == 4
+#define ENCODER_LOCK_FREE_READ
+#endif
+
+// ENCODER_USE_TIMESTAMPS records the time of the last edge and the time
+// between the last 2 edges, for velocity().  ENCODER_TIMESTAMP() is the
+// clock, counting ENCODER_TIMESTAMP_HZ per second.  micros() works on all
+// boards, but costs several microseconds per edge on 16 MHz AVR and about
+// 1 us on ESP8266/ESP32, because it reads a timer and does some math.
+// A cycle counter is much cheaper, a single register read on Teensy 3/4
+// (ARM_DWT_CYCCNT, F_CPU_ACTUAL) or ESP32 (ESP.getCycleCount(), F_CPU),
+// but velocity() can not see edges older than half its wrap time.
+// ENCODER_GLITCH_FILTER is the shortest time, in ENCODER_TIMESTAMP()
+// ticks, between 2 real edges.  An interrupt sooner than this after the
+// last accepted one is bounce, and returns without reading the pins.
+// Rejected edges are counted by rejectedEdges().  Set it below the time
+// between edges at the fastest real speed, or steps will be lost.
+// Because the last edge of a burst may be rejected, the next read()
+// checks the pins after a rejection, until an interrupt or read() has
+// seen them.  Otherwise reads stay as cheap as without the filter.
+#if defined(ENCODER_USE_TIMESTAMPS) || defined(ENCODER_EVENT_BUFFER_SIZE) || \
+  defined(ENCODER_GLITCH_FILTER)
+#ifndef ENCODER_TIMESTAMP
+#define ENCODER_TIMESTAMP()	micros()
+#define ENCODER_TIMESTAMP_HZ	1000000
+#endif
+#endif
+#ifdef ENCODER_USE_TIMESTAMPS
+// velocity() uses the change in count when at least this many counts
+// occurred since it was last called, or the edge period when fewer.
+#ifndef ENCODER_VELOCITY_MIN_COUNTS
+#define ENCODER_VELOCITY_MIN_COUNTS	4
+#endif
+// No edge for this long (in timestamp ticks) means stopped.
+#ifndef ENCODER_VELOCITY_TIMEOUT
+#define ENCODER_VELOCITY_TIMEOUT	ENCODER_TIMESTAMP_HZ
+#endif
+// interpolatedRead() returns the position with this many fraction bits.
+#ifndef ENCODER_INTERP_BITS
+#define ENCODER_INTERP_BITS	8
+#endif
+#if ENCODER_INTERP_BITS < 1 || ENCODER_INTERP_BITS > 16
+#error "ENCODER_INTERP_BITS must be 1 to 16"
+#endif
+// interpolatedRead() may run in a control interrupt, where on AVR
+// interrupts() would let others nest inside it, so the previous state
+// is restored instead.
+#if defined(__AVR__)
+#define ENCODER_INTERP_LOCK()		uint8_t sreg = SREG; cli()
+#define ENCODER_INTERP_UNLOCK()		SREG = sreg
+#else
+#define ENCODER_INTERP_LOCK()		noInterrupts()
+#define ENCODER_INTERP_UNLOCK()		interrupts()
+#endif
+#endif
+
+// ENCODER_EVENT_BUFFER_SIZE makes update() record every step (time,
+// change in count and new pin state) in a ring buffer, which the sketch
+// drains with readEvents() without disabling interrupts.  The size must
+// be a power of 2, up to 128 events.  Each event uses 6 bytes of RAM,
+// or 8 on 32 bit processors.  Steps which arrive when the buffer is
+// full are counted by eventOverflows().
+#ifdef ENCODER_EVENT_BUFFER_SIZE
+#if ENCODER_EVENT_BUFFER_SIZE < 2 || ENCODER_EVENT_BUFFER_SIZE > 128 || \
+  (ENCODER_EVENT_BUFFER_SIZE & (ENCODER_EVENT_BUFFER_SIZE - 1))
+#error "ENCODER_EVENT_BUFFER_SIZE must be 2, 4, 8, 16, 32, 64 or 128"
+#endif
+typedef struct {
+	uint32_t               time;	// ENCODER_TIMESTAMP() at the step
+	int8_t                 delta;	// change in count: -2, -1, +1, +2
+	uint8_t                pins;	// bit 0 = pin1, bit 1 = pin2
+} Encoder_event_t;
+#endif
+
+// ENCODER_USE_STATS counts transitions where the decoder had to guess
+// or saw nothing, which happen when interrupts are too slow for the
+// edge rate, or from noise and bounce.  Read them with stats().
+#ifdef ENCODER_USE_STATS
+typedef struct {
+	uint32_t               double_steps;	// both pins changed, +/-2 assumed
+	uint32_t               no_moves;	// update() found no change
+	bool                   overspeed;	// a double step since last stats()
+} Encoder_stats_t;
+#endif
+
+// ENCODER_COMPARE_SLOTS is the number of compare targets per encoder
+// (up to 8), armed with armCompare().  When update() moves the position
+// onto or past a target, it sets that slot's flag, for compareReached(),
+// and calls its callback, if any, from the interrupt.  With a pitch,
+// the target then moves by pitch for the next crossing, otherwise it
+// is disarmed.  Use a pitch of more than 2 counts.  Moves made by
+// write(), readAndReset() or an index reset never trigger.
+#ifdef ENCODER_COMPARE_SLOTS
+#if ENCODER_COMPARE_SLOTS < 1 || ENCODER_COMPARE_SLOTS > 8
+#error "ENCODER_COMPARE_SLOTS must be 1 to 8"
+#endif
+typedef void (*Encoder_compare_callback_t)(uint8_t slot, int32_t target);
+#endif
+
+// ENCODER_CHANGE_NOTIFY sets a flag in update() whenever the position
+// changes, for readIfChanged() and waitForChange().  On ESP32, a task
+// sleeping in waitForChange() is woken by a FreeRTOS task notification
+// (which uses that task's notification value), so it uses no CPU while
+// the encoder is idle.  Elsewhere, waitForChange() calls yield() until
+// a change or timeout.  ENCODER_CHANGE_HOOK(arg), if defined, is also
+// called from update() on every change, to wake other kinds of waiters.
+#ifdef ENCODER_CHANGE_NOTIFY
+#if defined(ESP32) && defined(ENCODER_USE_INTERRUPTS)
+#define ENCODER_CHANGE_TASK_NOTIFY
+#endif
+#ifndef ENCODER_CHANGE_HOOK
+#define ENCODER_CHANGE_HOOK(arg)
+#endif
+#endif
+
+// ENCODER_RESOLUTION sets how many counts per quadrature cycle every
+// encoder gives.  4 (the default) counts every edge of both pins.  2
+// only attaches an interrupt to pin1, and counts both of its edges,
+// for half the interrupts.  Direction comes from pin2's level at each
+// pin1 edge.  1 attaches the same interrupt, and counts +1 when pin1
+// rises and -1 when it falls, both while pin2 is high, so jitter
+// across that edge cancels.  Pin1 edges while pin2 is low count nothing.
+#ifndef ENCODER_RESOLUTION
+#define ENCODER_RESOLUTION	4
+#endif
+#if ENCODER_RESOLUTION != 4 && ENCODER_RESOLUTION != 2 && ENCODER_RESOLUTION != 1
+#error "ENCODER_RESOLUTION must be 1, 2 or 4"
+#endif
+
+// These options need to know the result of each update, so the
+// C version is used on AVR too.
+#if defined(ENCODER_USE_TIMESTAMPS) || defined(ENCODER_EVENT_BUFFER_SIZE) || \
+  defined(ENCODER_USE_STATS) || defined(ENCODER_COMPARE_SLOTS) || \
+  defined(ENCODER_CHANGE_NOTIFY)
+#define ENCODER_UPDATE_HOOKS
+#endif
+#if defined(__AVR__) && !defined(ENCODER_UPDATE_HOOKS) && ENCODER_RESOLUTION == 4
+#define ENCODER_AVR_ASM
+#endif
+
+// ENCODER_SHARED_FINISHUP saves flash on AVR.  The assembly update() is
+// inlined into every interrupt handler and every read(), and each copy
+// normally carries its own 36 word jump table and add/subtract code.
+// With this option, they all icall 1 shared copy of that code instead,
+// which should save about 72 bytes for every copy of update() after the
+// first (an estimate, counted from the code, not measured on a build),
+// and costs 5 more cycles per update (icall is 1 cycle slower than
+// ijmp, plus 4 for the ret).  Ignored on chips with more than 128K flash.
+#if defined(ENCODER_AVR_ASM) && defined(ENCODER_SHARED_FINISHUP) && !defined(__AVR_3_BYTE_PC__)
+#define ENCODER_AVR_SHARED_FINISHUP
+#endif
+
+// ENCODER_ISR_INSTRUMENTATION measures every encoder interrupt, from
+// entry to exit (including edges ENCODER_GLITCH_FILTER rejects), with
+// ENCODER_CYCLE_COUNT(), which counts ENCODER_CYCLE_HZ per second.
+// Read the results with isrStats().
+// The cycle counter is the CPU's own on Cortex-M3/M4/M7 (DWT, enabled
+// by the first Encoder) and Xtensa (CCOUNT).  AVR uses timer0, which
+// the Arduino core runs at 1/64 of the CPU clock, so times are only
+// accurate to 64 cycles.  Other boards fall back to micros().
+// ENCODER_ISR_ENTRY(arg) and ENCODER_ISR_EXIT(arg) are called at the
+// start and end of every encoder interrupt, for example to toggle a pin
+// for a logic analyzer, with or without ENCODER_ISR_INSTRUMENTATION.
+#ifdef ENCODER_ISR_INSTRUMENTATION
+#ifndef ENCODER_CYCLE_COUNT
+#if defined(__AVR__)
+#define ENCODER_CYCLE_COUNT()	((uint32_t)TCNT0 << 6)
+#define ENCODER_CYCLE_MASK	0x3FFF
+#define ENCODER_CYCLE_HZ	F_CPU
+#elif defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#define ENCODER_CYCLE_COUNT()	(*(volatile uint32_t *)0xE0001004)	// DWT_CYCCNT
+#define ENCODER_CYCLE_BEGIN()	do { \
+	*(volatile uint32_t *)0xE000EDFC |= 0x01000000;	/* DEMCR TRCENA */ \
+	*(volatile uint32_t *)0xE0001000 |= 1;		/* DWT_CTRL CYCCNTENA */ \
+	} while (0)
+#if defined(F_CPU_ACTUAL)
+#define ENCODER_CYCLE_HZ	F_CPU_ACTUAL
+#else
+#define ENCODER_CYCLE_HZ	F_CPU
+#endif
+#elif defined(__XTENSA__)
+static inline uint32_t IRAM_ATTR encoder_ccount(void) {
+	uint32_t ccount;
+	asm volatile ("rsr %0, ccount" : "=a" (ccount));
+	return ccount;
+}
+#define ENCODER_CYCLE_COUNT()	encoder_ccount()
+#define ENCODER_CYCLE_HZ	F_CPU
+#else
+#define ENCODER_CYCLE_COUNT()	micros()
+#define ENCODER_CYCLE_HZ	1000000
+#endif
+#endif
+#ifndef ENCODER_CYCLE_MASK
+#define ENCODER_CYCLE_MASK	0xFFFFFFFF
+#endif
+#ifndef ENCODER_CYCLE_BEGIN
+#define ENCODER_CYCLE_BEGIN()
+#endif
+typedef struct {
+	uint32_t               count;	// number of interrupts
+	uint32_t               min;	// fastest, in ENCODER_CYCLE_COUNT() ticks
+	uint32_t               max;	// slowest
+	uint32_t               average;
+} Encoder_isr_stats_t;
+#endif
+#ifndef ENCODER_ISR_ENTRY
+#define ENCODER_ISR_ENTRY(arg)
+#endif
+#ifndef ENCODER_ISR_EXIT
+#define ENCODER_ISR_EXIT(arg)
+#endif
+
+// ENCODER_USE_HARDWARE_COUNTER lets a quadrature counter peripheral do
+// the counting, with no interrupt per edge.  Only ESP32 chips with PCNT
+// (Arduino-ESP32 3.x) are supported, other boards ignore this option.
+// Options which need to see every edge (timestamps, events, stats,
+// index) can't be used with it.
+#if defined(ENCODER_USE_HARDWARE_COUNTER) && !defined(ENCODER_UPDATE_HOOKS) && \
+  !defined(ENCODER_USE_INDEX) && ENCODER_RESOLUTION == 4
+#include "utility/hardware_counter.h"
+#endif
 
 // All the data needed by interrupts is consolidated into this ugly struct
 // to facilitate assembly language optimizing of the speed critical update.
@@ -72,9 +324,81 @@ typedef struct {
 	IO_REG_TYPE            pin2_bitmask;
 	uint8_t                state;
 	int32_t                position;
+	// optional data, only used by the C version of update()
+#ifdef ENCODER_USE_TIMESTAMPS
+	uint32_t               edge_time;
+	uint32_t               edge_period;
+	int8_t                 edge_delta;
+#endif
+#ifdef ENCODER_EVENT_BUFFER_SIZE
+	// single producer (update) single consumer (readEvents) ring
+	Encoder_event_t        events[ENCODER_EVENT_BUFFER_SIZE];
+	volatile uint8_t       event_head;
+	volatile uint8_t       event_tail;
+	uint32_t               event_overflows;
+#endif
+#ifdef ENCODER_USE_STATS
+	uint32_t               double_steps;
+	uint32_t               no_moves;
+	uint8_t                overspeed;
+#endif
+#ifdef ENCODER_ISR_INSTRUMENTATION
+	uint32_t               isr_count;
+	uint32_t               isr_min;
+	uint32_t               isr_max;
+	uint64_t               isr_total;
+#endif
+#ifdef ENCODER_GLITCH_FILTER
+	uint32_t               glitch_time;
+	uint32_t               rejected_edges;
+	volatile uint8_t       glitch_pending;	// pins not read since a rejection
+#endif
+#ifdef ENCODER_USE_INDEX
+	volatile IO_REG_TYPE * index_register;	// NULL when no index pin
+	IO_REG_TYPE            index_bitmask;
+	uint8_t                index_level;
+	uint8_t                index_reset;	// set position to index_value
+	int32_t                index_value;
+	int32_t                index_position;	// position at the last index
+	int32_t                index_origin;	// position just after it
+	int32_t                index_period;	// counts between the last 2
+	uint32_t               index_count;
+	uint32_t               index_resets;	// times index_reset moved position
+	int32_t                index_jump;	// total position change by them
+#endif
+#ifdef ENCODER_COMPARE_SLOTS
+	// no armed target is between compare_low and compare_high, so
+	// update() only looks at the slots when position leaves them
+	int32_t                compare_low;
+	int32_t                compare_high;
+	int32_t                compare_target[ENCODER_COMPARE_SLOTS];
+	int32_t                compare_pitch[ENCODER_COMPARE_SLOTS];
+	Encoder_compare_callback_t compare_callback[ENCODER_COMPARE_SLOTS];
+	uint8_t                compare_armed;	// 1 bit per slot
+	volatile uint8_t       compare_flags;	// 1 bit per slot
+#endif
+#ifdef ENCODER_CHANGE_NOTIFY
+	volatile uint8_t       changed;
+#ifdef ENCODER_CHANGE_TASK_NOTIFY
+	TaskHandle_t volatile  waiting_task;
+#endif
+#endif
 } Encoder_internal_state_t;
 
+#ifndef ENCODER_USE_INTERRUPT_ARG
 static Encoder_internal_state_t * interruptArgs[ENCODER_ARGLIST_SIZE];
+#endif
+
+#if defined(ENCODER_USE_LOOKUP_TABLE) || defined(ENCODER_UPDATE_HOOKS)
+// Position change for each of the 16 states in the table below, indexed
+// by (new pin2, new pin1, old pin2, old pin1).  Used by the C version of
+// update() when ENCODER_USE_LOOKUP_TABLE is defined before Encoder.h is
+// included.  Adding from a table avoids the switch, which compiles to
+// a jump table or compare chain with hard to predict branches.
+static const int8_t ENCODER_ISR_DATA encoder_position_delta[16] = {
+	0, 1, -1, 2, -1, 0, -2, 1, 1, -2, 0, -1, 2, -1, 1, 0
+};
+#endif
 
 
 //                           _______         _______       
@@ -124,18 +448,277 @@ static Encoder_internal_state_t * interruptArgs[ENCODER_ARGLIST_SIZE];
 	}
 */
 
+#ifdef ENCODER_COMPARE_SLOTS
+#define ENCODER_COMPARE_NONE_BELOW	((int32_t)0x80000000)
+#define ENCODER_COMPARE_NONE_ABOVE	((int32_t)0x7FFFFFFF)
+// Find the nearest armed targets below and above position.
+static void IRAM_ATTR compare_window(Encoder_internal_state_t *arg, int32_t position) {
+	int32_t low = ENCODER_COMPARE_NONE_BELOW;
+	int32_t high = ENCODER_COMPARE_NONE_ABOVE;
+	for (uint8_t i=0; i < ENCODER_COMPARE_SLOTS; i++) {
+		if (!(arg->compare_armed & (1 << i))) continue;
+		int32_t target = arg->compare_target[i];
+		if (target > position) {
+			if (target < high) high = target;
+		} else {
+			if (target > low) low = target;
+		}
+	}
+	arg->compare_low = low;
+	arg->compare_high = high;
+}
+// The position moved by delta to now, outside the window.
+static void IRAM_ATTR compare_check(Encoder_internal_state_t *arg, int32_t now, int8_t delta) {
+	int32_t before = now - delta;
+	for (uint8_t i=0; i < ENCODER_COMPARE_SLOTS; i++) {
+		uint8_t bit = 1 << i;
+		if (!(arg->compare_armed & bit)) continue;
+		int32_t target = arg->compare_target[i];
+		if ((delta > 0) ? (target > before && target <= now) :
+		  (target < before && target >= now)) {
+			arg->compare_flags |= bit;
+			if (arg->compare_pitch[i]) {
+				arg->compare_target[i] = target + arg->compare_pitch[i];
+			} else {
+				arg->compare_armed &= ~bit;
+			}
+			if (arg->compare_callback[i]) arg->compare_callback[i](i, target);
+		}
+	}
+	compare_window(arg, now);
+}
+#endif
+
+#ifdef ENCODER_UPDATE_HOOKS
+// Optional work done by update() after the position is changed by delta.
+static inline void IRAM_ATTR update_hooks(Encoder_internal_state_t *arg, int8_t delta) {
+#ifdef ENCODER_USE_STATS
+	if (!delta) {
+		arg->no_moves++;
+	} else if (!(delta & 1)) {
+		arg->double_steps++;
+		arg->overspeed = 1;
+	}
+#endif
+	if (delta) {
+#if defined(ENCODER_USE_TIMESTAMPS) || defined(ENCODER_EVENT_BUFFER_SIZE)
+		uint32_t now = ENCODER_TIMESTAMP();
+#endif
+#ifdef ENCODER_USE_TIMESTAMPS
+		arg->edge_period = now - arg->edge_time;
+		arg->edge_time = now;
+		arg->edge_delta = delta;
+#endif
+#ifdef ENCODER_EVENT_BUFFER_SIZE
+		uint8_t head = arg->event_head;
+		if ((uint8_t)(head - arg->event_tail) >= ENCODER_EVENT_BUFFER_SIZE) {
+			arg->event_overflows++;
+		} else {
+			Encoder_event_t *e = &arg->events[head & (ENCODER_EVENT_BUFFER_SIZE - 1)];
+			e->time = now;
+			e->delta = delta;
+			e->pins = arg->state & 3;
+			// the event must be complete before the consumer sees it
+			__atomic_thread_fence(__ATOMIC_RELEASE);
+			arg->event_head = head + 1;
+		}
+#endif
+#ifdef ENCODER_COMPARE_SLOTS
+		int32_t position = arg->position;
+		if (position >= arg->compare_high || position <= arg->compare_low) {
+			compare_check(arg, position, delta);
+		}
+#endif
+#ifdef ENCODER_CHANGE_NOTIFY
+		arg->changed = 1;
+#ifdef ENCODER_CHANGE_TASK_NOTIFY
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		TaskHandle_t task = arg->waiting_task;
+		if (task) {
+			if (xPortInIsrContext()) {
+				BaseType_t woken = pdFALSE;
+				vTaskNotifyGiveFromISR(task, &woken);
+				if (woken) portYIELD_FROM_ISR();
+			} else {
+				xTaskNotifyGive(task);
+			}
+		}
+#endif
+		ENCODER_CHANGE_HOOK(arg);
+#endif
+	}
+}
+#endif
+
+// The C version of update(), after the pins are read.
+static inline void IRAM_ATTR update_pins(Encoder_internal_state_t *arg, uint8_t p1val, uint8_t p2val) {
+#if ENCODER_RESOLUTION < 4
+	// only pin1 edges count: at x2 both, when pin2 is the same as pin1
+	// after the edge it's +1.  At x1 only while pin2 is high, +1 rising
+	// and -1 falling.
+	uint8_t old = arg->state;
+	arg->state = p1val | (p2val << 1);
+	int8_t delta = 0;
+#if ENCODER_RESOLUTION == 2
+	if (p1val != (old & 1)) delta = (p1val == p2val) ? 1 : -1;
+#else
+	if (p2val && p1val != (old & 1)) delta = p1val ? 1 : -1;
+#endif
+	arg->position += delta;
+#ifdef ENCODER_UPDATE_HOOKS
+	update_hooks(arg, delta);
+#endif
+#elif defined(ENCODER_USE_LOOKUP_TABLE) || defined(ENCODER_UPDATE_HOOKS)
+	uint8_t state = (arg->state & 3) | (p1val << 2) | (p2val << 3);
+	arg->state = (state >> 2);
+	int8_t delta = encoder_position_delta[state];
+	arg->position += delta;
+#ifdef ENCODER_UPDATE_HOOKS
+	update_hooks(arg, delta);
+#endif
+#else
+	uint8_t state = arg->state & 3;
+	if (p1val) state |= 4;
+	if (p2val) state |= 8;
+	arg->state = (state >> 2);
+	switch (state) {
+		case 1: case 7: case 8: case 14:
+			arg->position++;
+			return;
+		case 2: case 4: case 11: case 13:
+			arg->position--;
+			return;
+		case 3: case 12:
+			arg->position += 2;
+			return;
+		case 6: case 9:
+			arg->position -= 2;
+			return;
+	}
+#endif
+}
+
 // update() is not meant to be called from outside Encoder,
 // but it is public to allow static interrupt routines.
 // DO NOT call update() directly from sketches.
+#ifdef ENCODER_USE_INDEX
+// ENCODER_USE_INDEX adds an optional third pin, the index (Z) pulse,
+// which encoders give once per revolution.  Its rising edge latches the
+// position, and optionally sets the position to a reference value.
+// The index pin interrupt uses the same update() as the other pins,
+// and every update() looks for the rising edge, so an index pin without
+// interrupts is still caught at the next edge on pin1 or pin2.  The
+// index pulse is usually wider than 1 count, so the latched position
+// differs by a count or so between directions.  A reset moves the
+// origin of velocity() and read64(), like write() does.  Index pin
+// interrupts run through isr_run() like the others, so they count in
+// isrStats(), and ENCODER_GLITCH_FILTER may reject them, or an A/B
+// edge just after them.  Either way, the next read() checks the pins
+// and the index, so the count is right, but the latched position may
+// be from 1 edge later.
+static inline void IRAM_ATTR update_index(Encoder_internal_state_t *arg) {
+	if (!arg->index_register) return;
+	uint8_t level = DIRECT_PIN_READ(arg->index_register, arg->index_bitmask);
+	if (level && !arg->index_level) {
+		int32_t position = arg->position;
+		arg->index_period = position - arg->index_origin;
+		arg->index_position = position;
+		if (arg->index_reset) {
+			arg->index_jump += arg->index_value - position;
+			arg->index_resets++;
+			position = arg->position = arg->index_value;
+		}
+		arg->index_origin = position;
+		arg->index_count++;
+	}
+	arg->index_level = level;
+}
+#endif
+
+#ifdef ENCODER_AVR_ASM
+// The end of the assembly update(), entered at table + the old and new
+// pin states (0-15), with r22-r25 = position and X just past it.  Each
+// entry jumps to code which adds the change and stores the position.
+// L prefixes the labels.
+#define ENCODER_AVR_FINISHUP(L) \
+	L "table:"		"\n\t" \
+	"rjmp	" L "end"	"\n\t"	/* 0 */ \
+	"rjmp	" L "plus1"	"\n\t"	/* 1 */ \
+	"rjmp	" L "minus1"	"\n\t"	/* 2 */ \
+	"rjmp	" L "plus2"	"\n\t"	/* 3 */ \
+	"rjmp	" L "minus1"	"\n\t"	/* 4 */ \
+	"rjmp	" L "end"	"\n\t"	/* 5 */ \
+	"rjmp	" L "minus2"	"\n\t"	/* 6 */ \
+	"rjmp	" L "plus1"	"\n\t"	/* 7 */ \
+	"rjmp	" L "plus1"	"\n\t"	/* 8 */ \
+	"rjmp	" L "minus2"	"\n\t"	/* 9 */ \
+	"rjmp	" L "end"	"\n\t"	/* 10 */ \
+	"rjmp	" L "minus1"	"\n\t"	/* 11 */ \
+	"rjmp	" L "plus2"	"\n\t"	/* 12 */ \
+	"rjmp	" L "minus1"	"\n\t"	/* 13 */ \
+	"rjmp	" L "plus1"	"\n\t"	/* 14 */ \
+	"rjmp	" L "end"	"\n\t"	/* 15 */ \
+	L "minus2:"		"\n\t" \
+	"subi	r22, 2"		"\n\t" \
+	"sbci	r23, 0"		"\n\t" \
+	"sbci	r24, 0"		"\n\t" \
+	"sbci	r25, 0"		"\n\t" \
+	"rjmp	" L "store"	"\n\t" \
+	L "minus1:"		"\n\t" \
+	"subi	r22, 1"		"\n\t" \
+	"sbci	r23, 0"		"\n\t" \
+	"sbci	r24, 0"		"\n\t" \
+	"sbci	r25, 0"		"\n\t" \
+	"rjmp	" L "store"	"\n\t" \
+	L "plus2:"		"\n\t" \
+	"subi	r22, 254"	"\n\t" \
+	"rjmp	" L "z"		"\n\t" \
+	L "plus1:"		"\n\t" \
+	"subi	r22, 255"	"\n\t" \
+	L "z:"			"\n\t" \
+	"sbci	r23, 255"	"\n\t" \
+	"sbci	r24, 255"	"\n\t" \
+	"sbci	r25, 255"	"\n\t" \
+	L "store:"		"\n\t" \
+	"st	-X, r25"	"\n\t" \
+	"st	-X, r24"	"\n\t" \
+	"st	-X, r23"	"\n\t" \
+	"st	-X, r22"	"\n\t" \
+	L "end:"		"\n\t"
+
+#ifdef ENCODER_AVR_SHARED_FINISHUP
+// The 1 shared copy, for ENCODER_SHARED_FINISHUP.  update() icalls its
+// table, so it must start at this function's address.  Inline gives it
+// external linkage, so when several files include Encoder.h, the linker
+// keeps only 1 of them.  Nothing in C calls it, hence used (and
+// externally_visible, so LTO keeps the name the asm refers to).
+extern "C" inline __attribute__((naked, noinline, used, externally_visible))
+void encoder_update_finishup(void) {
+	asm (	ENCODER_AVR_FINISHUP(".Lencoder_")
+		"ret"			"\n");
+}
+#endif
+
+#ifdef ENCODER_AVR_SHARED_FINISHUP
+#define ENCODER_AVR_TABLE	"encoder_update_finishup"
+#else
+#define ENCODER_AVR_TABLE	"L%=table"
+#endif
+
+#endif
+
 static void IRAM_ATTR update(Encoder_internal_state_t *arg) {
-#if defined(__AVR__)
+#ifdef ENCODER_AVR_ASM
 		// The compiler believes this is just 1 line of code, so
 		// it will inline this function into each interrupt
 		// handler.  That's a tiny bit faster, but grows the code.
 		// Especially when used with ENCODER_OPTIMIZE_INTERRUPTS,
 		// the inline nature allows the ISR prologue and epilogue
 		// to only save/restore necessary registers, for very nice
-		// speed increase.
+		// speed increase.  The asm moves X and writes the state,
+		// so code after it (index, instrumentation) gets the real
+		// arg and a fresh read of memory.
+		Encoder_internal_state_t *x = arg;
 		asm volatile (
 			"ld	r30, X+"		"\n\t"
 			"ld	r31, X+"		"\n\t"
@@ -153,8 +736,8 @@ static void IRAM_ATTR update(Encoder_internal_state_t *arg) {
 		"L%=1:"	"and	r25, r31"		"\n\t"
 			"breq	L%=2"			"\n\t"	// if (pin2)
 			"ori	r22, 8"			"\n\t"	//	state |= 8
-		"L%=2:" "ldi	r30, lo8(pm(L%=table))"	"\n\t"
-			"ldi	r31, hi8(pm(L%=table))"	"\n\t"
+		"L%=2:" "ldi	r30, lo8(pm(" ENCODER_AVR_TABLE "))"	"\n\t"
+			"ldi	r31, hi8(pm(" ENCODER_AVR_TABLE "))"	"\n\t"
 			"add	r30, r22"		"\n\t"
 			"adc	r31, __zero_reg__"	"\n\t"
 			"asr	r22"			"\n\t"
@@ -164,407 +747,926 @@ static void IRAM_ATTR update(Encoder_internal_state_t *arg) {
 			"ld	r23, X+"		"\n\t"
 			"ld	r24, X+"		"\n\t"
 			"ld	r25, X+"		"\n\t"
-			"ijmp"				"\n\t"	// jumps to update_finishup()
-			// TODO move this table to another static function,
-			// so it doesn't get needlessly duplicated.  Easier
-			// said than done, due to linker issues and inlining
-		"L%=table:"				"\n\t"
-			"rjmp	L%=end"			"\n\t"	// 0
-			"rjmp	L%=plus1"		"\n\t"	// 1
-			"rjmp	L%=minus1"		"\n\t"	// 2
-			"rjmp	L%=plus2"		"\n\t"	// 3
-			"rjmp	L%=minus1"		"\n\t"	// 4
-			"rjmp	L%=end"			"\n\t"	// 5
-			"rjmp	L%=minus2"		"\n\t"	// 6
-			"rjmp	L%=plus1"		"\n\t"	// 7
-			"rjmp	L%=plus1"		"\n\t"	// 8
-			"rjmp	L%=minus2"		"\n\t"	// 9
-			"rjmp	L%=end"			"\n\t"	// 10
-			"rjmp	L%=minus1"		"\n\t"	// 11
-			"rjmp	L%=plus2"		"\n\t"	// 12
-			"rjmp	L%=minus1"		"\n\t"	// 13
-			"rjmp	L%=plus1"		"\n\t"	// 14
-			"rjmp	L%=end"			"\n\t"	// 15
-		"L%=minus2:"				"\n\t"
-			"subi	r22, 2"			"\n\t"
-			"sbci	r23, 0"			"\n\t"
-			"sbci	r24, 0"			"\n\t"
-			"sbci	r25, 0"			"\n\t"
-			"rjmp	L%=store"		"\n\t"
-		"L%=minus1:"				"\n\t"
-			"subi	r22, 1"			"\n\t"
-			"sbci	r23, 0"			"\n\t"
-			"sbci	r24, 0"			"\n\t"
-			"sbci	r25, 0"			"\n\t"
-			"rjmp	L%=store"		"\n\t"
-		"L%=plus2:"				"\n\t"
-			"subi	r22, 254"		"\n\t"
-			"rjmp	L%=z"			"\n\t"
-		"L%=plus1:"				"\n\t"
-			"subi	r22, 255"		"\n\t"
-		"L%=z:"	"sbci	r23, 255"		"\n\t"
-			"sbci	r24, 255"		"\n\t"
-			"sbci	r25, 255"		"\n\t"
-		"L%=store:"				"\n\t"
-			"st	-X, r25"		"\n\t"
-			"st	-X, r24"		"\n\t"
-			"st	-X, r23"		"\n\t"
-			"st	-X, r22"		"\n\t"
-		"L%=end:"				"\n"
-		: : "x" (arg) : "r22", "r23", "r24", "r25", "r30", "r31");
+#ifdef ENCODER_AVR_SHARED_FINISHUP
+			"icall"				"\n\t"	// calls encoder_update_finishup()
 #else
-		uint8_t p1val = DIRECT_PIN_READ(arg->pin1_register, arg->pin1_bitmask);
-		uint8_t p2val = DIRECT_PIN_READ(arg->pin2_register, arg->pin2_bitmask);
-		uint8_t state = arg->state & 3;
-		if (p1val) state |= 4;
-		if (p2val) state |= 8;
-		arg->state = (state >> 2);
-		switch (state) {
-			case 1: case 7: case 8: case 14:
-				arg->position++;
-				return;
-			case 2: case 4: case 11: case 13:
-				arg->position--;
-				return;
-			case 3: case 12:
-				arg->position += 2;
-				return;
-			case 6: case 9:
-				arg->position -= 2;
-				return;
-		}
+			"ijmp"				"\n\t"
+			ENCODER_AVR_FINISHUP("L%=")
+#endif
+		: "+x" (x) : : "r22", "r23", "r24", "r25", "r30", "r31", "memory");
+#else
+		update_pins(arg,
+			DIRECT_PIN_READ(arg->pin1_register, arg->pin1_bitmask),
+			DIRECT_PIN_READ(arg->pin2_register, arg->pin2_bitmask));
+#endif
+#ifdef ENCODER_GLITCH_FILTER
+		arg->glitch_pending = 0;
+#endif
+#ifdef ENCODER_USE_INDEX
+		update_index(arg);
 #endif
 	}
 
-#if defined(ENCODER_USE_INTERRUPTS) && !defined(ENCODER_OPTIMIZE_INTERRUPTS)
+// update() as called by interrupts, with the optional measurement and
+// user hooks around it.  FastEncoder's interrupt runs its own update
+// function through here, so everything below applies to it too.
+template <void (*UPDATE)(Encoder_internal_state_t *)>
+static inline void IRAM_ATTR isr_run(Encoder_internal_state_t *arg) {
+	ENCODER_ISR_ENTRY(arg);
+#ifdef ENCODER_ISR_INSTRUMENTATION
+	uint32_t begin = ENCODER_CYCLE_COUNT();
+#endif
+#ifdef ENCODER_GLITCH_FILTER
+	uint32_t now = ENCODER_TIMESTAMP();
+	if (now - arg->glitch_time < (uint32_t)(ENCODER_GLITCH_FILTER)) {
+		// rejected, but still an interrupt for isrStats()
+		arg->rejected_edges++;
+		arg->glitch_pending = 1;
+	} else {
+		arg->glitch_time = now;
+		UPDATE(arg);
+		arg->glitch_pending = 0;
+	}
+#else
+	UPDATE(arg);
+#endif
+#ifdef ENCODER_ISR_INSTRUMENTATION
+	uint32_t cycles = (ENCODER_CYCLE_COUNT() - begin) & ENCODER_CYCLE_MASK;
+	arg->isr_count++;
+	arg->isr_total += cycles;
+	if (cycles < arg->isr_min) arg->isr_min = cycles;
+	if (cycles > arg->isr_max) arg->isr_max = cycles;
+#endif
+	ENCODER_ISR_EXIT(arg);
+}
+static inline void IRAM_ATTR isr_update(Encoder_internal_state_t *arg) {
+	isr_run<update>(arg);
+}
+
+#if defined(ENCODER_USE_INTERRUPTS) && defined(ENCODER_USE_INTERRUPT_ARG)
+	static void IRAM_ATTR isr_arg(void *arg) { isr_update((Encoder_internal_state_t *)arg); }
+#elif defined(ENCODER_USE_INTERRUPTS) && !defined(ENCODER_OPTIMIZE_INTERRUPTS)
 	#ifdef CORE_INT0_PIN
-	static void IRAM_ATTR isr0(void) { update(interruptArgs[0]); }
+	static void IRAM_ATTR isr0(void) { isr_update(interruptArgs[0]); }
 	#endif
 	#ifdef CORE_INT1_PIN
-	static void IRAM_ATTR isr1(void) { update(interruptArgs[1]); }
+	static void IRAM_ATTR isr1(void) { isr_update(interruptArgs[1]); }
 	#endif
 	#ifdef CORE_INT2_PIN
-	static void IRAM_ATTR isr2(void) { update(interruptArgs[2]); }
+	static void IRAM_ATTR isr2(void) { isr_update(interruptArgs[2]); }
 	#endif
 	#ifdef CORE_INT3_PIN
-	static void IRAM_ATTR isr3(void) { update(interruptArgs[3]); }
+	static void IRAM_ATTR isr3(void) { isr_update(interruptArgs[3]); }
 	#endif
 	#ifdef CORE_INT4_PIN
-	static void IRAM_ATTR isr4(void) { update(interruptArgs[4]); }
+	static void IRAM_ATTR isr4(void) { isr_update(interruptArgs[4]); }
 	#endif
 	#ifdef CORE_INT5_PIN
-	static void IRAM_ATTR isr5(void) { update(interruptArgs[5]); }
+	static void IRAM_ATTR isr5(void) { isr_update(interruptArgs[5]); }
 	#endif
 	#ifdef CORE_INT6_PIN
-	static void IRAM_ATTR isr6(void) { update(interruptArgs[6]); }
+	static void IRAM_ATTR isr6(void) { isr_update(interruptArgs[6]); }
 	#endif
 	#ifdef CORE_INT7_PIN
-	static void IRAM_ATTR isr7(void) { update(interruptArgs[7]); }
+	static void IRAM_ATTR isr7(void) { isr_update(interruptArgs[7]); }
 	#endif
 	#ifdef CORE_INT8_PIN
-	static void IRAM_ATTR isr8(void) { update(interruptArgs[8]); }
+	static void IRAM_ATTR isr8(void) { isr_update(interruptArgs[8]); }
 	#endif
 	#ifdef CORE_INT9_PIN
-	static void IRAM_ATTR isr9(void) { update(interruptArgs[9]); }
+	static void IRAM_ATTR isr9(void) { isr_update(interruptArgs[9]); }
 	#endif
 	#ifdef CORE_INT10_PIN
-	static void IRAM_ATTR isr10(void) { update(interruptArgs[10]); }
+	static void IRAM_ATTR isr10(void) { isr_update(interruptArgs[10]); }
 	#endif
 	#ifdef CORE_INT11_PIN
-	static void IRAM_ATTR isr11(void) { update(interruptArgs[11]); }
+	static void IRAM_ATTR isr11(void) { isr_update(interruptArgs[11]); }
 	#endif
 	#ifdef CORE_INT12_PIN
-	static void IRAM_ATTR isr12(void) { update(interruptArgs[12]); }
+	static void IRAM_ATTR isr12(void) { isr_update(interruptArgs[12]); }
 	#endif
 	#ifdef CORE_INT13_PIN
-	static void IRAM_ATTR isr13(void) { update(interruptArgs[13]); }
+	static void IRAM_ATTR isr13(void) { isr_update(interruptArgs[13]); }
 	#endif
 	#ifdef CORE_INT14_PIN
-	static void IRAM_ATTR isr14(void) { update(interruptArgs[14]); }
+	static void IRAM_ATTR isr14(void) { isr_update(interruptArgs[14]); }
 	#endif
 	#ifdef CORE_INT15_PIN
-	static void IRAM_ATTR isr15(void) { update(interruptArgs[15]); }
+	static void IRAM_ATTR isr15(void) { isr_update(interruptArgs[15]); }
 	#endif
 	#ifdef CORE_INT16_PIN
-	static void IRAM_ATTR isr16(void) { update(interruptArgs[16]); }
+	static void IRAM_ATTR isr16(void) { isr_update(interruptArgs[16]); }
 	#endif
 	#ifdef CORE_INT17_PIN
-	static void IRAM_ATTR isr17(void) { update(interruptArgs[17]); }
+	static void IRAM_ATTR isr17(void) { isr_update(interruptArgs[17]); }
 	#endif
 	#ifdef CORE_INT18_PIN
-	static void IRAM_ATTR isr18(void) { update(interruptArgs[18]); }
+	static void IRAM_ATTR isr18(void) { isr_update(interruptArgs[18]); }
 	#endif
 	#ifdef CORE_INT19_PIN
-	static void IRAM_ATTR isr19(void) { update(interruptArgs[19]); }
+	static void IRAM_ATTR isr19(void) { isr_update(interruptArgs[19]); }
 	#endif
 	#ifdef CORE_INT20_PIN
-	static void IRAM_ATTR isr20(void) { update(interruptArgs[20]); }
+	static void IRAM_ATTR isr20(void) { isr_update(interruptArgs[20]); }
 	#endif
 	#ifdef CORE_INT21_PIN
-	static void IRAM_ATTR isr21(void) { update(interruptArgs[21]); }
+	static void IRAM_ATTR isr21(void) { isr_update(interruptArgs[21]); }
 	#endif
 	#ifdef CORE_INT22_PIN
-	static void IRAM_ATTR isr22(void) { update(interruptArgs[22]); }
+	static void IRAM_ATTR isr22(void) { isr_update(interruptArgs[22]); }
 	#endif
 	#ifdef CORE_INT23_PIN
-	static void IRAM_ATTR isr23(void) { update(interruptArgs[23]); }
+	static void IRAM_ATTR isr23(void) { isr_update(interruptArgs[23]); }
 	#endif
 	#ifdef CORE_INT24_PIN
-	static void IRAM_ATTR isr24(void) { update(interruptArgs[24]); }
+	static void IRAM_ATTR isr24(void) { isr_update(interruptArgs[24]); }
 	#endif
 	#ifdef CORE_INT25_PIN
-	static void IRAM_ATTR isr25(void) { update(interruptArgs[25]); }
+	static void IRAM_ATTR isr25(void) { isr_update(interruptArgs[25]); }
 	#endif
 	#ifdef CORE_INT26_PIN
-	static void IRAM_ATTR isr26(void) { update(interruptArgs[26]); }
+	static void IRAM_ATTR isr26(void) { isr_update(interruptArgs[26]); }
 	#endif
 	#ifdef CORE_INT27_PIN
-	static void IRAM_ATTR isr27(void) { update(interruptArgs[27]); }
+	static void IRAM_ATTR isr27(void) { isr_update(interruptArgs[27]); }
 	#endif
 	#ifdef CORE_INT28_PIN
-	static void IRAM_ATTR isr28(void) { update(interruptArgs[28]); }
+	static void IRAM_ATTR isr28(void) { isr_update(interruptArgs[28]); }
 	#endif
 	#ifdef CORE_INT29_PIN
-	static void IRAM_ATTR isr29(void) { update(interruptArgs[29]); }
+	static void IRAM_ATTR isr29(void) { isr_update(interruptArgs[29]); }
 	#endif
 	#ifdef CORE_INT30_PIN
-	static void IRAM_ATTR isr30(void) { update(interruptArgs[30]); }
+	static void IRAM_ATTR isr30(void) { isr_update(interruptArgs[30]); }
 	#endif
 	#ifdef CORE_INT31_PIN
-	static void IRAM_ATTR isr31(void) { update(interruptArgs[31]); }
+	static void IRAM_ATTR isr31(void) { isr_update(interruptArgs[31]); }
 	#endif
 	#ifdef CORE_INT32_PIN
-	static void IRAM_ATTR isr32(void) { update(interruptArgs[32]); }
+	static void IRAM_ATTR isr32(void) { isr_update(interruptArgs[32]); }
 	#endif
 	#ifdef CORE_INT33_PIN
-	static void IRAM_ATTR isr33(void) { update(interruptArgs[33]); }
+	static void IRAM_ATTR isr33(void) { isr_update(interruptArgs[33]); }
 	#endif
 	#ifdef CORE_INT34_PIN
-	static void IRAM_ATTR isr34(void) { update(interruptArgs[34]); }
+	static void IRAM_ATTR isr34(void) { isr_update(interruptArgs[34]); }
 	#endif
 	#ifdef CORE_INT35_PIN
-	static void IRAM_ATTR isr35(void) { update(interruptArgs[35]); }
+	static void IRAM_ATTR isr35(void) { isr_update(interruptArgs[35]); }
 	#endif
 	#ifdef CORE_INT36_PIN
-	static void IRAM_ATTR isr36(void) { update(interruptArgs[36]); }
+	static void IRAM_ATTR isr36(void) { isr_update(interruptArgs[36]); }
 	#endif
 	#ifdef CORE_INT37_PIN
-	static void IRAM_ATTR isr37(void) { update(interruptArgs[37]); }
+	static void IRAM_ATTR isr37(void) { isr_update(interruptArgs[37]); }
 	#endif
 	#ifdef CORE_INT38_PIN
-	static void IRAM_ATTR isr38(void) { update(interruptArgs[38]); }
+	static void IRAM_ATTR isr38(void) { isr_update(interruptArgs[38]); }
 	#endif
 	#ifdef CORE_INT39_PIN
-	static void IRAM_ATTR isr39(void) { update(interruptArgs[39]); }
+	static void IRAM_ATTR isr39(void) { isr_update(interruptArgs[39]); }
 	#endif
 	#ifdef CORE_INT40_PIN
-	static void IRAM_ATTR isr40(void) { update(interruptArgs[40]); }
+	static void IRAM_ATTR isr40(void) { isr_update(interruptArgs[40]); }
 	#endif
 	#ifdef CORE_INT41_PIN
-	static void IRAM_ATTR isr41(void) { update(interruptArgs[41]); }
+	static void IRAM_ATTR isr41(void) { isr_update(interruptArgs[41]); }
 	#endif
 	#ifdef CORE_INT42_PIN
-	static void IRAM_ATTR isr42(void) { update(interruptArgs[42]); }
+	static void IRAM_ATTR isr42(void) { isr_update(interruptArgs[42]); }
 	#endif
 	#ifdef CORE_INT43_PIN
-	static void IRAM_ATTR isr43(void) { update(interruptArgs[43]); }
+	static void IRAM_ATTR isr43(void) { isr_update(interruptArgs[43]); }
 	#endif
 	#ifdef CORE_INT44_PIN
-	static void IRAM_ATTR isr44(void) { update(interruptArgs[44]); }
+	static void IRAM_ATTR isr44(void) { isr_update(interruptArgs[44]); }
 	#endif
 	#ifdef CORE_INT45_PIN
-	static void IRAM_ATTR isr45(void) { update(interruptArgs[45]); }
+	static void IRAM_ATTR isr45(void) { isr_update(interruptArgs[45]); }
 	#endif
 	#ifdef CORE_INT46_PIN
-	static void IRAM_ATTR isr46(void) { update(interruptArgs[46]); }
+	static void IRAM_ATTR isr46(void) { isr_update(interruptArgs[46]); }
 	#endif
 	#ifdef CORE_INT47_PIN
-	static void IRAM_ATTR isr47(void) { update(interruptArgs[47]); }
+	static void IRAM_ATTR isr47(void) { isr_update(interruptArgs[47]); }
 	#endif
 	#ifdef CORE_INT48_PIN
-	static void IRAM_ATTR isr48(void) { update(interruptArgs[48]); }
+	static void IRAM_ATTR isr48(void) { isr_update(interruptArgs[48]); }
 	#endif
 	#ifdef CORE_INT49_PIN
-	static void IRAM_ATTR isr49(void) { update(interruptArgs[49]); }
+	static void IRAM_ATTR isr49(void) { isr_update(interruptArgs[49]); }
 	#endif
 	#ifdef CORE_INT50_PIN
-	static void IRAM_ATTR isr50(void) { update(interruptArgs[50]); }
+	static void IRAM_ATTR isr50(void) { isr_update(interruptArgs[50]); }
 	#endif
 	#ifdef CORE_INT51_PIN
-	static void IRAM_ATTR isr51(void) { update(interruptArgs[51]); }
+	static void IRAM_ATTR isr51(void) { isr_update(interruptArgs[51]); }
 	#endif
 	#ifdef CORE_INT52_PIN
-	static void IRAM_ATTR isr52(void) { update(interruptArgs[52]); }
+	static void IRAM_ATTR isr52(void) { isr_update(interruptArgs[52]); }
 	#endif
 	#ifdef CORE_INT53_PIN
-	static void IRAM_ATTR isr53(void) { update(interruptArgs[53]); }
+	static void IRAM_ATTR isr53(void) { isr_update(interruptArgs[53]); }
 	#endif
 	#ifdef CORE_INT54_PIN
-	static void IRAM_ATTR isr54(void) { update(interruptArgs[54]); }
+	static void IRAM_ATTR isr54(void) { isr_update(interruptArgs[54]); }
 	#endif
 	#ifdef CORE_INT55_PIN
-	static void IRAM_ATTR isr55(void) { update(interruptArgs[55]); }
+	static void IRAM_ATTR isr55(void) { isr_update(interruptArgs[55]); }
 	#endif
 	#ifdef CORE_INT56_PIN
-	static void IRAM_ATTR isr56(void) { update(interruptArgs[56]); }
+	static void IRAM_ATTR isr56(void) { isr_update(interruptArgs[56]); }
 	#endif
 	#ifdef CORE_INT57_PIN
-	static void IRAM_ATTR isr57(void) { update(interruptArgs[57]); }
+	static void IRAM_ATTR isr57(void) { isr_update(interruptArgs[57]); }
 	#endif
 	#ifdef CORE_INT58_PIN
-	static void IRAM_ATTR isr58(void) { update(interruptArgs[58]); }
+	static void IRAM_ATTR isr58(void) { isr_update(interruptArgs[58]); }
 	#endif
 	#ifdef CORE_INT59_PIN
-	static void IRAM_ATTR isr59(void) { update(interruptArgs[59]); }
+	static void IRAM_ATTR isr59(void) { isr_update(interruptArgs[59]); }
+	#endif
+#endif
+
+// ENCODER_USE_PCINT gives AVR pins without an external interrupt (INTn)
+// a pin change interrupt instead, so on an Uno, every pin can count in
+// interrupt mode, rather than only pins 2 and 3.  Encoders sharing a
+// port share 1 interrupt, see utility/pcint.h.
+#if defined(ENCODER_USE_PCINT) && defined(ENCODER_USE_INTERRUPTS) && \
+  !defined(ENCODER_USE_INTERRUPT_ARG)
+#include "utility/pcint.h"
+#endif
+
+// Configure both pins and fill in the state for a new encoder.
+// Used by the constructors, not meant to be called from sketches.
+static void init_state(Encoder_internal_state_t *s, uint8_t pin1, uint8_t pin2) {
+	#ifdef INPUT_PULLUP
+	pinMode(pin1, INPUT_PULLUP);
+	pinMode(pin2, INPUT_PULLUP);
+	#else
+	pinMode(pin1, INPUT);
+	digitalWrite(pin1, HIGH);
+	pinMode(pin2, INPUT);
+	digitalWrite(pin2, HIGH);
 	#endif
+	s->pin1_register = PIN_TO_BASEREG(pin1);
+	s->pin1_bitmask = PIN_TO_BITMASK(pin1);
+	s->pin2_register = PIN_TO_BASEREG(pin2);
+	s->pin2_bitmask = PIN_TO_BITMASK(pin2);
+	s->position = 0;
+	// allow time for a passive R-C filter to charge
+	// through the pullup resistors, before reading
+	// the initial state
+	delayMicroseconds(2000);
+	uint8_t state = 0;
+	if (DIRECT_PIN_READ(s->pin1_register, s->pin1_bitmask)) state |= 1;
+	if (DIRECT_PIN_READ(s->pin2_register, s->pin2_bitmask)) state |= 2;
+	s->state = state;
+#ifdef ENCODER_USE_TIMESTAMPS
+	s->edge_time = ENCODER_TIMESTAMP();
+	s->edge_period = 0;
+	s->edge_delta = 0;
+#endif
+#ifdef ENCODER_EVENT_BUFFER_SIZE
+	s->event_head = 0;
+	s->event_tail = 0;
+	s->event_overflows = 0;
+#endif
+#ifdef ENCODER_USE_STATS
+	s->double_steps = 0;
+	s->no_moves = 0;
+	s->overspeed = 0;
+#endif
+#ifdef ENCODER_ISR_INSTRUMENTATION
+	ENCODER_CYCLE_BEGIN();
+	s->isr_count = 0;
+	s->isr_min = 0xFFFFFFFF;
+	s->isr_max = 0;
+	s->isr_total = 0;
+#endif
+#ifdef ENCODER_GLITCH_FILTER
+	s->glitch_time = ENCODER_TIMESTAMP() - (uint32_t)(ENCODER_GLITCH_FILTER);
+	s->rejected_edges = 0;
+	s->glitch_pending = 0;
+#endif
+#ifdef ENCODER_USE_INDEX
+	s->index_register = 0;
+	s->index_reset = 0;
+	s->index_value = 0;
+	s->index_position = 0;
+	s->index_origin = 0;
+	s->index_period = 0;
+	s->index_count = 0;
+	s->index_resets = 0;
+	s->index_jump = 0;
+#endif
+#ifdef ENCODER_COMPARE_SLOTS
+	s->compare_low = ENCODER_COMPARE_NONE_BELOW;
+	s->compare_high = ENCODER_COMPARE_NONE_ABOVE;
+	s->compare_armed = 0;
+	s->compare_flags = 0;
+#endif
+#ifdef ENCODER_CHANGE_NOTIFY
+	s->changed = 0;
+#ifdef ENCODER_CHANGE_TASK_NOTIFY
+	s->waiting_task = NULL;
+#endif
 #endif
+}
 
 class Encoder
 {
 public:
 	Encoder(uint8_t pin1, uint8_t pin2) {
+		if (!init(pin1, pin2)) return;
+#ifdef ENCODER_USE_INTERRUPTS
+		interrupts_in_use = attach_pins(pin1, pin2, &encoder);
+#endif
+	}
+#ifdef ENCODER_USE_INDEX
+	Encoder(uint8_t pin1, uint8_t pin2, uint8_t index_pin) : Encoder(pin1, pin2) {
 		#ifdef INPUT_PULLUP
-		pinMode(pin1, INPUT_PULLUP);
-		pinMode(pin2, INPUT_PULLUP);
+		pinMode(index_pin, INPUT_PULLUP);
 		#else
-		pinMode(pin1, INPUT);
-		digitalWrite(pin1, HIGH);
-		pinMode(pin2, INPUT);
-		digitalWrite(pin2, HIGH);
-		#endif
-		encoder.pin1_register = PIN_TO_BASEREG(pin1);
-		encoder.pin1_bitmask = PIN_TO_BITMASK(pin1);
-		encoder.pin2_register = PIN_TO_BASEREG(pin2);
-		encoder.pin2_bitmask = PIN_TO_BITMASK(pin2);
-		encoder.position = 0;
-		// allow time for a passive R-C filter to charge
-		// through the pullup resistors, before reading
-		// the initial state
-		delayMicroseconds(2000);
-		uint8_t s = 0;
-		if (DIRECT_PIN_READ(encoder.pin1_register, encoder.pin1_bitmask)) s |= 1;
-		if (DIRECT_PIN_READ(encoder.pin2_register, encoder.pin2_bitmask)) s |= 2;
-		encoder.state = s;
-#ifdef ENCODER_USE_INTERRUPTS
-		interrupts_in_use = attach_interrupt(pin1, &encoder);
-		interrupts_in_use += attach_interrupt(pin2, &encoder);
+		pinMode(index_pin, INPUT);
+		digitalWrite(index_pin, HIGH);
+		#endif
+		noInterrupts();
+		encoder.index_bitmask = PIN_TO_BITMASK(index_pin);
+		encoder.index_register = PIN_TO_BASEREG(index_pin);
+		encoder.index_level = DIRECT_PIN_READ(encoder.index_register, encoder.index_bitmask);
+		encoder.index_origin = encoder.position;
+		interrupts();
+#if defined(ENCODER_USE_INTERRUPTS) && ENCODER_RESOLUTION != 1
+		attach_interrupt(index_pin, &encoder);
 #endif
-		//update_finishup();  // to force linker to include the code (does not work)
 	}
+#endif
 
 
 #ifdef ENCODER_USE_INTERRUPTS
 	inline int32_t read() {
-		if (interrupts_in_use < 2) {
-			noInterrupts();
-			update(&encoder);
-		} else {
-			noInterrupts();
+#ifdef ENCODER_HARDWARE_COUNTER
+		if (hw_in_use) return seen(hw_offset + encoder_hw_count(&hw));
+#endif
+#ifdef ENCODER_LOCK_FREE_READ
+		if (!must_poll()) {
+			return seen(__atomic_load_n(&encoder.position, __ATOMIC_RELAXED));
 		}
+#endif
+		noInterrupts();
+		if (must_poll()) update(&encoder);
+		seen_index();
 		int32_t ret = encoder.position;
 		interrupts();
-		return ret;
+		return seen(ret);
 	}
 	inline int32_t readAndReset() {
-		if (interrupts_in_use < 2) {
-			noInterrupts();
-			update(&encoder);
-		} else {
-			noInterrupts();
+#ifdef ENCODER_HARDWARE_COUNTER
+		if (hw_in_use) return hw_write(0);
+#endif
+#ifdef ENCODER_LOCK_FREE_READ
+		if (!must_poll()) {
+			// if an interrupt changes position during the exchange,
+			// the exchange is retried, so no count is ever lost
+			int32_t ret = __atomic_exchange_n(&encoder.position, 0, __ATOMIC_RELAXED);
+			moved_origin(seen(ret), 0);
+			return ret;
 		}
+#endif
+		noInterrupts();
+		if (must_poll()) update(&encoder);
+		seen_index();
 		int32_t ret = encoder.position;
 		encoder.position = 0;
 		interrupts();
+		moved_origin(seen(ret), 0);
 		return ret;
 	}
 	inline void write(int32_t p) {
+#ifdef ENCODER_HARDWARE_COUNTER
+		if (hw_in_use) {
+			hw_write(p);
+			return;
+		}
+#endif
+#ifdef ENCODER_LOCK_FREE_READ
+		int32_t old = __atomic_exchange_n(&encoder.position, p, __ATOMIC_RELAXED);
+#else
 		noInterrupts();
+		seen_index();
+		int32_t old = encoder.position;
 		encoder.position = p;
 		interrupts();
+#endif
+		moved_origin(old, p);
 	}
 #else
+	// When another engine (eg, EncoderScanner) keeps this encoder
+	// updated, read() must not also call update(), and the position
+	// may change from an interrupt, so it is copied with them off.
 	inline int32_t read() {
+#ifdef ENCODER_HARDWARE_COUNTER
+		if (hw_in_use) return seen(hw_offset + encoder_hw_count(&hw));
+#endif
+		if (updated_elsewhere) {
+			noInterrupts();
+			seen_index();
+			int32_t ret = encoder.position;
+			interrupts();
+			return seen(ret);
+		}
 		update(&encoder);
-		return encoder.position;
+		seen_index();
+		return seen(encoder.position);
 	}
 	inline int32_t readAndReset() {
-		update(&encoder);
+#ifdef ENCODER_HARDWARE_COUNTER
+		if (hw_in_use) return hw_write(0);
+#endif
+		if (updated_elsewhere) {
+			noInterrupts();
+		} else {
+			update(&encoder);
+		}
+		seen_index();
 		int32_t ret = encoder.position;
 		encoder.position = 0;
+		if (updated_elsewhere) interrupts();
+		moved_origin(seen(ret), 0);
 		return ret;
 	}
 	inline void write(int32_t p) {
+#ifdef ENCODER_HARDWARE_COUNTER
+		if (hw_in_use) {
+			hw_write(p);
+			return;
+		}
+#endif
+		if (updated_elsewhere) noInterrupts();
+		seen_index();
+		int32_t old = encoder.position;
 		encoder.position = p;
+		if (updated_elsewhere) interrupts();
+		moved_origin(old, p);
+	}
+#endif
+#ifdef ENCODER_USE_TIMESTAMPS
+	// Speed in counts per second.  At high speed, this is the change
+	// in count since the last call, divided by the time between the
+	// edges which caused it.  At low speed, when fewer than
+	// ENCODER_VELOCITY_MIN_COUNTS occurred, the time between the last
+	// 2 edges is used, or the time since the last edge, if longer.
+	float velocity() {
+		noInterrupts();
+#ifdef ENCODER_USE_INTERRUPTS
+		if (must_poll()) update(&encoder);
+#else
+		if (!updated_elsewhere) update(&encoder);
+#endif
+		int32_t position = encoder.position;
+		uint32_t edge_time = encoder.edge_time;
+		uint32_t edge_period = encoder.edge_period;
+		int8_t edge_delta = encoder.edge_delta;
+#ifdef ENCODER_USE_INDEX
+		int32_t jump = encoder.index_jump;
+#endif
+		interrupts();
+#ifdef ENCODER_USE_INDEX
+		// index resets moved the position, but not the encoder
+		velocity_position += jump - velocity_jump;
+		velocity_jump = jump;
+#endif
+		int32_t counts = position - velocity_position;
+		uint32_t elapsed = edge_time - velocity_time;
+		velocity_position = position;
+		velocity_time = edge_time;
+		if ((counts >= ENCODER_VELOCITY_MIN_COUNTS ||
+		  counts <= -ENCODER_VELOCITY_MIN_COUNTS) && elapsed > 0) {
+			return (float)counts * (float)ENCODER_TIMESTAMP_HZ / (float)elapsed;
+		}
+		uint32_t since = ENCODER_TIMESTAMP() - edge_time;
+		if (since >= ENCODER_VELOCITY_TIMEOUT || edge_period == 0) {
+			return 0.0f;
+		}
+		if (since > edge_period) edge_period = since;
+		return (float)edge_delta * (float)ENCODER_TIMESTAMP_HZ / (float)edge_period;
+	}
+	// Position with ENCODER_INTERP_BITS of fraction, for control loops
+	// which would see the count as a staircase at low speed.  Count n
+	// covers the motion from n to n+1, entered at n going forward and
+	// at n+1 going back.  The fraction assumes the encoder keeps moving
+	// the way the last edge went, one count per edge period, and stops
+	// just short of the next boundary, so it never disagrees with
+	// read() (shifting the result right gives read()).  When stopped
+	// longer than ENCODER_VELOCITY_TIMEOUT, it stays there.  The
+	// fraction uses ENCODER_INTERP_BITS steps of shift and subtract,
+	// no division, so it's cheap enough for a fast control interrupt.
+	// The count must fit in 31 - ENCODER_INTERP_BITS bits.
+	int32_t interpolatedRead() {
+		ENCODER_INTERP_LOCK();
+#ifdef ENCODER_USE_INTERRUPTS
+		if (must_poll()) update(&encoder);
+#else
+		if (!updated_elsewhere) update(&encoder);
+#endif
+		int32_t position = encoder.position;
+		uint32_t edge_time = encoder.edge_time;
+		uint32_t edge_period = encoder.edge_period;
+		int8_t edge_delta = encoder.edge_delta;
+		ENCODER_INTERP_UNLOCK();
+		const uint32_t one = (uint32_t)1 << ENCODER_INTERP_BITS;
+		uint32_t fixed = (uint32_t)position << ENCODER_INTERP_BITS;
+		if (edge_delta == 0) return fixed;
+		uint32_t since = ENCODER_TIMESTAMP() - edge_time;
+		uint32_t frac = one - 1;
+		if (edge_period > ENCODER_VELOCITY_TIMEOUT) {
+			edge_period = ENCODER_VELOCITY_TIMEOUT;
+		}
+		if (since < edge_period) {
+			// frac = since * one / edge_period
+			frac = 0;
+			for (uint8_t i=0; i < ENCODER_INTERP_BITS; i++) {
+				since <<= 1;
+				frac <<= 1;
+				if (since >= edge_period) {
+					since -= edge_period;
+					frac |= 1;
+				}
+			}
+		}
+		if (edge_delta < 0) frac = one - 1 - frac;
+		return (int32_t)(fixed | frac);
+	}
+#endif
+#ifdef ENCODER_EVENT_BUFFER_SIZE
+	// Copy up to max of the oldest steps into events, and remove them
+	// from the buffer.  Returns the number copied.  Interrupts stay on.
+	uint8_t readEvents(Encoder_event_t *events, uint8_t max) {
+		uint8_t tail = encoder.event_tail;
+		uint8_t count = encoder.event_head - tail;
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (count > max) count = max;
+		for (uint8_t i=0; i < count; i++) {
+			events[i] = encoder.events[(uint8_t)(tail + i) & (ENCODER_EVENT_BUFFER_SIZE - 1)];
+		}
+		// the events must be copied before update() may reuse them
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		encoder.event_tail = tail + count;
+		return count;
+	}
+	// Number of steps lost because the buffer was full.
+	uint32_t eventOverflows() {
+		noInterrupts();
+		uint32_t ret = encoder.event_overflows;
+		interrupts();
+		return ret;
+	}
+#endif
+#ifdef ENCODER_USE_STATS
+	// Double steps mean edges were missed, so the count may be wrong.
+	// no_moves only means noise or bounce when both pins have
+	// interrupts, since read() without them also calls update().
+	Encoder_stats_t stats() {
+		Encoder_stats_t ret;
+		noInterrupts();
+		ret.double_steps = encoder.double_steps;
+		ret.no_moves = encoder.no_moves;
+		ret.overspeed = encoder.overspeed;
+		encoder.overspeed = 0;
+		interrupts();
+		return ret;
+	}
+#endif
+#ifdef ENCODER_USE_INTERRUPTS
+	// False when a pin got no interrupt, for example when its pin
+	// change group already has ENCODER_PCINT_MAX_PER_GROUP encoders.
+	// Then read() checks the pins itself, and steps between calls to
+	// read() can be lost.
+	bool interruptsAttached() {
+#ifdef ENCODER_HARDWARE_COUNTER
+		if (hw_in_use) return true;
+#endif
+		return interrupts_in_use >= 2;
+	}
+#endif
+#ifdef ENCODER_ISR_INSTRUMENTATION
+	// Number of interrupts and their time, in ENCODER_CYCLE_COUNT()
+	// ticks, since the start or resetIsrStats().
+	Encoder_isr_stats_t isrStats() {
+		Encoder_isr_stats_t ret;
+		noInterrupts();
+		ret.count = encoder.isr_count;
+		ret.min = encoder.isr_min;
+		ret.max = encoder.isr_max;
+		uint64_t total = encoder.isr_total;
+		interrupts();
+		if (ret.count == 0) ret.min = 0;
+		ret.average = ret.count ? total / ret.count : 0;
+		return ret;
+	}
+	void resetIsrStats() {
+		noInterrupts();
+		encoder.isr_count = 0;
+		encoder.isr_min = 0xFFFFFFFF;
+		encoder.isr_max = 0;
+		encoder.isr_total = 0;
+		interrupts();
+	}
+#endif
+#if defined(ENCODER_GLITCH_FILTER) && defined(ENCODER_USE_INTERRUPTS)
+	// Interrupts ignored by ENCODER_GLITCH_FILTER.
+	uint32_t rejectedEdges() {
+		noInterrupts();
+		uint32_t ret = encoder.rejected_edges;
+		interrupts();
+		return ret;
+	}
+#endif
+#ifdef ENCODER_USE_INDEX
+	// From now on, each index pulse sets the position to value.
+	void setIndexReset(bool enable, int32_t value = 0) {
+		noInterrupts();
+		encoder.index_value = value;
+		encoder.index_reset = enable;
+		interrupts();
+	}
+	// Number of index pulses seen.  Check this to know when
+	// indexPosition() and countsPerRevolution() have new values.
+	uint32_t indexCount() {
+		noInterrupts();
+		uint32_t ret = encoder.index_count;
+		interrupts();
+		return ret;
+	}
+	// Position at the most recent index pulse, before any reset.
+	int32_t indexPosition() {
+		noInterrupts();
+		int32_t ret = encoder.index_position;
+		interrupts();
+		return ret;
+	}
+	// Change in position between the last 2 index pulses, negative
+	// when turning backwards.  Only valid when indexCount() >= 2.
+	int32_t countsPerRevolution() {
+		noInterrupts();
+		int32_t ret = encoder.index_period;
+		interrupts();
+		return ret;
+	}
+#endif
+#ifdef ENCODER_COMPARE_SLOTS
+	// Arm a compare slot, to trigger when the position reaches target.
+	// callback (optional) is called from the interrupt, so keep it short.
+	bool armCompare(uint8_t slot, int32_t target, int32_t pitch = 0,
+	  Encoder_compare_callback_t callback = NULL) {
+		if (slot >= ENCODER_COMPARE_SLOTS) return false;
+		uint8_t bit = 1 << slot;
+		noInterrupts();
+		encoder.compare_target[slot] = target;
+		encoder.compare_pitch[slot] = pitch;
+		encoder.compare_callback[slot] = callback;
+		encoder.compare_flags &= ~bit;
+		encoder.compare_armed |= bit;
+		// only narrow the window, a wider one is fixed by update()
+		if (target > encoder.position) {
+			if (target < encoder.compare_high) encoder.compare_high = target;
+		} else {
+			if (target > encoder.compare_low) encoder.compare_low = target;
+		}
+		interrupts();
+		return true;
+	}
+	void disarmCompare(uint8_t slot) {
+		if (slot >= ENCODER_COMPARE_SLOTS) return;
+		noInterrupts();
+		encoder.compare_armed &= ~(1 << slot);
+		interrupts();
+	}
+	// True if the slot's target was reached since the last call.
+	bool compareReached(uint8_t slot) {
+		if (slot >= ENCODER_COMPARE_SLOTS) return false;
+		uint8_t bit = 1 << slot;
+		noInterrupts();
+		uint8_t flags = encoder.compare_flags;
+		encoder.compare_flags = flags & ~bit;
+		interrupts();
+		return flags & bit;
+	}
+#endif
+#ifdef ENCODER_CHANGE_NOTIFY
+	// If the position changed since the last readIfChanged(), store it
+	// and return true.  Otherwise return false, at almost no cost.
+	bool readIfChanged(int32_t *position) {
+		poll_if_needed();
+		if (!encoder.changed) return false;
+		encoder.changed = 0;
+		*position = read();
+		return true;
+	}
+	// Wait up to timeout milliseconds for the position to change.
+	// Returns true if it changed (since the last readIfChanged()).
+	bool waitForChange(uint32_t timeout) {
+#ifdef ENCODER_CHANGE_TASK_NOTIFY
+		if (!must_poll()) {
+			ulTaskNotifyTake(pdTRUE, 0);
+			encoder.waiting_task = xTaskGetCurrentTaskHandle();
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+			if (!encoder.changed) {
+				ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout));
+			}
+			encoder.waiting_task = NULL;
+			return encoder.changed;
+		}
+#endif
+		uint32_t begin_ms = millis();
+		while (1) {
+			poll_if_needed();
+			if (encoder.changed) return true;
+			if (millis() - begin_ms >= timeout) return false;
+			yield();
+		}
+	}
+#endif
+#ifdef ENCODER_USE_64BIT_POSITION
+	// Position as a 64 bit number, which never overflows.  Interrupts
+	// still count in 32 bits.  The upper bits are found by every read()
+	// and readAndReset(), from how far the 32 bit count moved since the
+	// previous one, so any of them must be called at least once per
+	// 2^31 counts.
+	int64_t read64() {
+		read();
+		return position64;
+	}
+	void write64(int64_t p) {
+		write((int32_t)p);
+		position64 = p;
 	}
 #endif
 private:
+	// For FastEncoder, which attaches its own interrupts.
+	struct no_attach_t { };
+	Encoder(uint8_t pin1, uint8_t pin2, no_attach_t) {
+		init(pin1, pin2);
+	}
+	// Everything the constructors do before attaching interrupts.
+	// Returns false if a hardware counter does the counting instead.
+	bool init(uint8_t pin1, uint8_t pin2) {
+		init_state(&encoder, pin1, pin2);
+#ifdef ENCODER_USE_TIMESTAMPS
+		velocity_position = 0;
+		velocity_time = encoder.edge_time;
+#ifdef ENCODER_USE_INDEX
+		velocity_jump = 0;
+#endif
+#endif
+#ifdef ENCODER_USE_64BIT_POSITION
+		position64 = 0;
+		position64_low = 0;
+#ifdef ENCODER_USE_INDEX
+		position64_resets = 0;
+#endif
+#endif
+#ifdef ENCODER_USE_INTERRUPTS
+		interrupts_in_use = 0;
+#else
+		updated_elsewhere = 0;
+#endif
+#ifdef ENCODER_HARDWARE_COUNTER
+		hw_offset = 0;
+		hw_in_use = encoder_hw_begin(&hw, pin1, pin2);
+		if (hw_in_use) return false;
+#endif
+		return true;
+	}
+#ifdef ENCODER_USE_INTERRUPTS
+	// read() must call update() when a pin has no interrupt, or the
+	// glitch filter rejected an edge which nothing has read since
+	inline bool must_poll() {
+#ifdef ENCODER_GLITCH_FILTER
+		if (encoder.glitch_pending) return true;
+#endif
+		return interrupts_in_use < 2;
+	}
+#endif
+#ifdef ENCODER_CHANGE_NOTIFY
+	// update() from here, when no interrupt or engine will call it
+	inline void poll_if_needed() {
+#ifdef ENCODER_USE_INTERRUPTS
+		if (must_poll()) {
+#else
+		if (!updated_elsewhere) {
+#endif
+			noInterrupts();
+			update(&encoder);
+			interrupts();
+		}
+	}
+#endif
+	// Called with interrupts off, just before the position is read.
+	// An index reset since the last one moved the position, so the
+	// 64 bit position starts again from there, as after write().
+	inline void seen_index() {
+#if defined(ENCODER_USE_INDEX) && defined(ENCODER_USE_64BIT_POSITION)
+		if (encoder.index_resets != position64_resets) {
+			position64_resets = encoder.index_resets;
+			position64 = encoder.index_origin;
+			position64_low = encoder.index_origin;
+		}
+#endif
+	}
+	// Every read of the position passes through here, to carry into
+	// the upper bits of the 64 bit position.
+	inline int32_t seen(int32_t now) {
+#ifdef ENCODER_USE_64BIT_POSITION
+		position64 += (int32_t)((uint32_t)now - (uint32_t)position64_low);
+		position64_low = now;
+#endif
+		return now;
+	}
+	// write() and readAndReset() moved the count from old to now,
+	// without any physical motion.
+	inline void moved_origin(int32_t old, int32_t now) {
+		(void)old;
+		(void)now;
+#ifdef ENCODER_USE_TIMESTAMPS
+		velocity_position += now - old;
+#endif
+#ifdef ENCODER_USE_64BIT_POSITION
+		position64 = now;
+		position64_low = now;
+#endif
+	}
+#ifdef ENCODER_HARDWARE_COUNTER
+	// The hardware count can only be cleared, so the position is kept
+	// as an offset from it.  Moving the offset instead of clearing the
+	// counter means no edge is lost.  Returns the old position.
+	int32_t hw_write(int32_t p) {
+		int32_t count = encoder_hw_count(&hw);
+		int32_t old = hw_offset + count;
+		hw_offset = p - count;
+		moved_origin(old, p);
+		return old;
+	}
+	Encoder_hw_counter_t hw;
+	int32_t hw_offset;
+	bool hw_in_use;
+#endif
 	Encoder_internal_state_t encoder;
+#ifdef ENCODER_USE_TIMESTAMPS
+	int32_t velocity_position;
+	uint32_t velocity_time;
+#ifdef ENCODER_USE_INDEX
+	int32_t velocity_jump;		// encoder.index_jump at the last velocity()
+#endif
+#endif
+#ifdef ENCODER_USE_64BIT_POSITION
+	int64_t position64;
+	int32_t position64_low;
+#ifdef ENCODER_USE_INDEX
+	uint32_t position64_resets;	// encoder.index_resets at the last read
+#endif
+#endif
 #ifdef ENCODER_USE_INTERRUPTS
 	uint8_t interrupts_in_use;
+#else
+	uint8_t updated_elsewhere;
+	friend class EncoderScanner;
 #endif
+	friend class EncoderSampler;
+	template <uint8_t N> friend class EncoderGroup;
+	template <uint8_t PIN1, uint8_t PIN2> friend class FastEncoder;
 
 private:
-/*
-#if defined(__AVR__)
-	// TODO: this must be a no inline function
-	// even noinline does not seem to solve difficult
-	// problems with this.  Oh well, it was only meant
-	// to shrink code size - there's no performance
-	// improvement in this, only code size reduction.
-	__attribute__((noinline)) void update_finishup(void) {
-		asm volatile (
-			"ldi	r30, lo8(pm(Ltable))"	"\n\t"
-			"ldi	r31, hi8(pm(Ltable))"	"\n\t"
-		"Ltable:"				"\n\t"
-			"rjmp	L%=end"			"\n\t"	// 0
-			"rjmp	L%=plus1"		"\n\t"	// 1
-			"rjmp	L%=minus1"		"\n\t"	// 2
-			"rjmp	L%=plus2"		"\n\t"	// 3
-			"rjmp	L%=minus1"		"\n\t"	// 4
-			"rjmp	L%=end"			"\n\t"	// 5
-			"rjmp	L%=minus2"		"\n\t"	// 6
-			"rjmp	L%=plus1"		"\n\t"	// 7
-			"rjmp	L%=plus1"		"\n\t"	// 8
-			"rjmp	L%=minus2"		"\n\t"	// 9
-			"rjmp	L%=end"			"\n\t"	// 10
-			"rjmp	L%=minus1"		"\n\t"	// 11
-			"rjmp	L%=plus2"		"\n\t"	// 12
-			"rjmp	L%=minus1"		"\n\t"	// 13
-			"rjmp	L%=plus1"		"\n\t"	// 14
-			"rjmp	L%=end"			"\n\t"	// 15
-		"L%=minus2:"				"\n\t"
-			"subi	r22, 2"			"\n\t"
-			"sbci	r23, 0"			"\n\t"
-			"sbci	r24, 0"			"\n\t"
-			"sbci	r25, 0"			"\n\t"
-			"rjmp	L%=store"		"\n\t"
-		"L%=minus1:"				"\n\t"
-			"subi	r22, 1"			"\n\t"
-			"sbci	r23, 0"			"\n\t"
-			"sbci	r24, 0"			"\n\t"
-			"sbci	r25, 0"			"\n\t"
-			"rjmp	L%=store"		"\n\t"
-		"L%=plus2:"				"\n\t"
-			"subi	r22, 254"		"\n\t"
-			"rjmp	L%=z"			"\n\t"
-		"L%=plus1:"				"\n\t"
-			"subi	r22, 255"		"\n\t"
-		"L%=z:"	"sbci	r23, 255"		"\n\t"
-			"sbci	r24, 255"		"\n\t"
-			"sbci	r25, 255"		"\n\t"
-		"L%=store:"				"\n\t"
-			"st	-X, r25"		"\n\t"
-			"st	-X, r24"		"\n\t"
-			"st	-X, r23"		"\n\t"
-			"st	-X, r22"		"\n\t"
-		"L%=end:"				"\n"
-		: : : "r22", "r23", "r24", "r25", "r30", "r31");
-	}
-#endif
-*/
 
 
 #ifdef ENCODER_USE_INTERRUPTS
+	// Attach the interrupts ENCODER_RESOLUTION needs.  Returns 2 when
+	// interrupts see every edge which counts, less if update() must
+	// also be called by read().
+	static uint8_t attach_pins(uint8_t pin1, uint8_t pin2, Encoder_internal_state_t *state) {
+#if ENCODER_RESOLUTION == 4
+		uint8_t n = attach_interrupt(pin1, state);
+		return n + attach_interrupt(pin2, state);
+#else
+		// only pin1 edges count, so pin2 needs no interrupt
+		(void)pin2;
+		return attach_interrupt(pin1, state) * 2;
+#endif
+	}
+#endif
+#if defined(ENCODER_USE_INTERRUPTS) && defined(ENCODER_USE_INTERRUPT_ARG)
+	static uint8_t attach_interrupt(uint8_t pin, Encoder_internal_state_t *state) {
+		int irq = digitalPinToInterrupt(pin);
+		if (irq < 0) return 0;
+#if defined(ARDUINO_ARCH_RP2040)
+		attachInterruptParam(irq, isr_arg, CHANGE, state);
+#else
+		attachInterruptArg(irq, isr_arg, state, CHANGE);
+#endif
+		return 1;
+	}
+#elif defined(ENCODER_USE_INTERRUPTS)
 	// this giant function is an unfortunate consequence of Arduino's
 	// attachInterrupt function not supporting any way to pass a pointer
 	// or other context to the attached function.
@@ -932,7 +2034,11 @@ private:
 				break;
 		#endif
 			default:
+		#ifdef ENCODER_PCINT
+				return encoder_pcint_attach(pin, state);
+		#else
 				return 0;
+		#endif
 		}
 		return 1;
 	}
@@ -943,28 +2049,28 @@ private:
 #if defined(ENCODER_USE_INTERRUPTS) && defined(ENCODER_OPTIMIZE_INTERRUPTS)
 #if defined(__AVR__)
 #if defined(INT0_vect) && CORE_NUM_INTERRUPT > 0
-ISR(INT0_vect) { Encoder::update(Encoder::interruptArgs[SCRAMBLE_INT_ORDER(0)]); }
+ISR(INT0_vect) { isr_update(interruptArgs[SCRAMBLE_INT_ORDER(0)]); }
 #endif
 #if defined(INT1_vect) && CORE_NUM_INTERRUPT > 1
-ISR(INT1_vect) { Encoder::update(Encoder::interruptArgs[SCRAMBLE_INT_ORDER(1)]); }
+ISR(INT1_vect) { isr_update(interruptArgs[SCRAMBLE_INT_ORDER(1)]); }
 #endif
 #if defined(INT2_vect) && CORE_NUM_INTERRUPT > 2
-ISR(INT2_vect) { Encoder::update(Encoder::interruptArgs[SCRAMBLE_INT_ORDER(2)]); }
+ISR(INT2_vect) { isr_update(interruptArgs[SCRAMBLE_INT_ORDER(2)]); }
 #endif
 #if defined(INT3_vect) && CORE_NUM_INTERRUPT > 3
-ISR(INT3_vect) { Encoder::update(Encoder::interruptArgs[SCRAMBLE_INT_ORDER(3)]); }
+ISR(INT3_vect) { isr_update(interruptArgs[SCRAMBLE_INT_ORDER(3)]); }
 #endif
 #if defined(INT4_vect) && CORE_NUM_INTERRUPT > 4
-ISR(INT4_vect) { Encoder::update(Encoder::interruptArgs[SCRAMBLE_INT_ORDER(4)]); }
+ISR(INT4_vect) { isr_update(interruptArgs[SCRAMBLE_INT_ORDER(4)]); }
 #endif
 #if defined(INT5_vect) && CORE_NUM_INTERRUPT > 5
-ISR(INT5_vect) { Encoder::update(Encoder::interruptArgs[SCRAMBLE_INT_ORDER(5)]); }
+ISR(INT5_vect) { isr_update(interruptArgs[SCRAMBLE_INT_ORDER(5)]); }
 #endif
 #if defined(INT6_vect) && CORE_NUM_INTERRUPT > 6
-ISR(INT6_vect) { Encoder::update(Encoder::interruptArgs[SCRAMBLE_INT_ORDER(6)]); }
+ISR(INT6_vect) { isr_update(interruptArgs[SCRAMBLE_INT_ORDER(6)]); }
 #endif
 #if defined(INT7_vect) && CORE_NUM_INTERRUPT > 7
-ISR(INT7_vect) { Encoder::update(Encoder::interruptArgs[SCRAMBLE_INT_ORDER(7)]); }
+ISR(INT7_vect) { isr_update(interruptArgs[SCRAMBLE_INT_ORDER(7)]); }
 #endif
 #endif // AVR
 #if defined(attachInterrupt)
@@ -0,0 +1,114 @@
+/* Encoder Library, for measuring quadrature encoded signals
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * EncoderGroup<N> - several encoders read at the same moment
+ *
+ * Reading each Encoder with read() disables interrupts once per
+ * encoder, so multi-axis machines get positions from slightly
+ * different times.  EncoderGroup keeps the state of N encoders in one
+ * array, and readAll() / readAndResetAll() copy every position inside
+ * a single short time with interrupts disabled.
+ *
+ * The positions can't be a separate array (structure of arrays),
+ * because update() and the AVR assembly require each encoder's
+ * position inside its own state struct.  The states are contiguous,
+ * so the copy loop walks memory in order.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef EncoderGroup_h_
+#define EncoderGroup_h_
+
+#include "Encoder.h"
+
+template <uint8_t N>
+class EncoderGroup
+{
+public:
+	EncoderGroup() : num_encoders(0), num_polled(0) {
+	}
+	// Add an encoder on these pins.  Positions are returned in the
+	// order the encoders were added.
+	bool add(uint8_t pin1, uint8_t pin2) {
+		if (num_encoders >= N) return false;
+		Encoder_internal_state_t *s = &state[num_encoders];
+		init_state(s, pin1, pin2);
+#ifdef ENCODER_USE_INTERRUPTS
+		uint8_t n = Encoder::attach_pins(pin1, pin2, s);
+		if (n < 2) polled[num_polled++] = num_encoders;
+#else
+		polled[num_polled++] = num_encoders;
+#endif
+		num_encoders++;
+		return true;
+	}
+	uint8_t count() { return num_encoders; }
+	// Copy all positions, from the same moment.
+	void readAll(int32_t *positions) {
+		noInterrupts();
+		update_polled();
+		for (uint8_t i=0; i < num_encoders; i++) {
+			positions[i] = state[i].position;
+		}
+		interrupts();
+	}
+	// Copy all positions and set them to zero, so each call gives the
+	// change since the previous one, with no count lost in between.
+	void readAndResetAll(int32_t *positions) {
+		noInterrupts();
+		update_polled();
+		for (uint8_t i=0; i < num_encoders; i++) {
+			positions[i] = state[i].position;
+			state[i].position = 0;
+		}
+		interrupts();
+	}
+	int32_t read(uint8_t index) {
+		noInterrupts();
+		update_polled();
+		int32_t ret = state[index].position;
+		interrupts();
+		return ret;
+	}
+	void write(uint8_t index, int32_t p) {
+		noInterrupts();
+		state[index].position = p;
+		interrupts();
+	}
+private:
+	// encoders without interrupts on both pins are updated on every read
+	inline void update_polled() {
+		for (uint8_t i=0; i < num_polled; i++) {
+			update(&state[polled[i]]);
+		}
+#if defined(ENCODER_GLITCH_FILTER) && defined(ENCODER_USE_INTERRUPTS)
+		// and those whose last edge the glitch filter rejected
+		for (uint8_t i=0; i < num_encoders; i++) {
+			if (state[i].glitch_pending) update(&state[i]);
+		}
+#endif
+	}
+	Encoder_internal_state_t state[N];
+	uint8_t num_encoders;
+	uint8_t polled[N];
+	uint8_t num_polled;
+};
+
+#endif
@@ -0,0 +1,318 @@
+/* Encoder Library, for measuring quadrature encoded signals
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * EncoderSampler - poll encoders at a fixed rate from a timer interrupt
+ *
+ * With ENCODER_DO_NOT_USE_INTERRUPTS, the count is only correct if the
+ * sketch calls read() often enough.  Any delay() or slow Serial printing
+ * loses steps.  EncoderSampler instead calls update() for each added
+ * encoder from a timer interrupt, at a fixed rate, and read() becomes
+ * a simple copy of the position.
+ *
+ * The sampling rate must be faster than the fastest edge rate you need
+ * to count.  Each sample can decode 1 step reliably (2 steps are
+ * assumed to be pin1 edges only), so at N samples/sec, an encoder with
+ * P pulses per revolution (4*P edges) is tracked up to N / (4*P)
+ * revolutions/sec.  sampleRate() and maxSampleMicros() tell how often
+ * sampling happens and the longest time any one sample has taken, so
+ * you can check the CPU budget: the interrupt uses about
+ * rate * maxSampleMicros() / 10000 percent of the CPU, at worst.
+ *
+ * On Teensy 3/4 (IntervalTimer) and ESP32, begin(rate) starts a timer.
+ * On other boards, begin(rate) returns false, and you must call
+ * sample() from your own timer interrupt (eg, using TimerOne) at the
+ * rate given to begin().
+ *
+ * Adaptive mode: without ENCODER_DO_NOT_USE_INTERRUPTS, encoders added
+ * with add(encoder, pin1, pin2) use their pin interrupts while slow.
+ * Every ENCODER_SAMPLER_WINDOW samples, the sampler estimates how many
+ * edges each one had, from the change in position and the number of
+ * samples where the pins differ from the previous sample (so vibration
+ * counts too).  Above 1 edge per 4 samples, it turns the pin interrupts
+ * off and samples the encoder instead, so the CPU time no longer grows
+ * with speed.  Below 1 edge per 8 samples, interrupts are turned back
+ * on, so idle encoders cost almost nothing.  Interrupts and sampling
+ * update the same state, so no count is lost in a switch.
+ *
+ * Sampling is only trusted while the rate given to begin() is at least
+ * twice the edge rate (the Nyquist rate for the edges), which leaves
+ * room for a burst to speed up before the next check.  The highest
+ * edge rate is remembered for a while, so the sampler doesn't take
+ * over while it's above half the sample rate, and an encoder going
+ * faster than that goes back to its interrupts.  So choose a rate of
+ * at least twice the fastest edge rate, to keep the CPU time bounded:
+ * at worst, the sampling at that rate, plus interrupts at half of it.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef EncoderSampler_h_
+#define EncoderSampler_h_
+
+#include "Encoder.h"
+
+#ifndef ENCODER_SAMPLER_MAX_ENCODERS
+#define ENCODER_SAMPLER_MAX_ENCODERS	8
+#endif
+// Number of samples between adaptive mode speed checks.
+#ifndef ENCODER_SAMPLER_WINDOW
+#define ENCODER_SAMPLER_WINDOW	64
+#endif
+
+// Turn a pin's encoder interrupt off and on, from the sampler's timer
+// interrupt.  ESP32's attachInterrupt() isn't safe there, so its GPIO
+// interrupt enable is used instead.
+#if defined(ENCODER_USE_INTERRUPTS) && defined(ESP32)
+#include "driver/gpio.h"
+#define ENCODER_SAMPLER_IRQ_OFF(pin)		gpio_intr_disable((gpio_num_t)(pin))
+#define ENCODER_SAMPLER_IRQ_ON(pin, state)	gpio_intr_enable((gpio_num_t)(pin))
+#elif defined(ENCODER_USE_INTERRUPTS) && defined(ENCODER_PCINT)
+#define ENCODER_SAMPLER_IRQ_OFF(pin)		do { \
+	if (digitalPinToInterrupt(pin) == NOT_AN_INTERRUPT) encoder_pcint_detach(pin); \
+	else detachInterrupt(digitalPinToInterrupt(pin)); \
+	} while (0)
+#define ENCODER_SAMPLER_IRQ_ON(pin, state)	Encoder::attach_interrupt((pin), (state))
+#elif defined(ENCODER_USE_INTERRUPTS)
+#define ENCODER_SAMPLER_IRQ_OFF(pin)		detachInterrupt(digitalPinToInterrupt(pin))
+#define ENCODER_SAMPLER_IRQ_ON(pin, state)	Encoder::attach_interrupt((pin), (state))
+#endif
+
+// Keep the pin interrupts out while adapt() switches.  It runs in the
+// timer interrupt, and on AVR interrupts() there would let any other
+// interrupt nest inside it, so the previous state is restored instead.
+#if defined(__AVR__)
+#define ENCODER_SAMPLER_LOCK()		uint8_t sreg = SREG; cli()
+#define ENCODER_SAMPLER_UNLOCK()	SREG = sreg
+#else
+#define ENCODER_SAMPLER_LOCK()		noInterrupts()
+#define ENCODER_SAMPLER_UNLOCK()	interrupts()
+#endif
+
+class EncoderSampler
+{
+public:
+	EncoderSampler() : num_encoders(0), rate(0), max_us(0), count(0),
+	  window(0), switches(0) {
+	}
+	// Add an encoder.  With ENCODER_DO_NOT_USE_INTERRUPTS, from now on
+	// its read() only returns the position found by the most recent
+	// sample().  With interrupts, it's only sampled if a pin lacks an
+	// interrupt.
+	bool add(Encoder &enc) {
+		if (num_encoders >= ENCODER_SAMPLER_MAX_ENCODERS) return false;
+		entry_t *e = &list[num_encoders];
+		e->state = &enc.encoder;
+		e->adaptive = 0;
+#ifdef ENCODER_USE_INTERRUPTS
+		e->polled = (enc.interrupts_in_use < 2);
+#else
+		e->polled = 1;
+#endif
+		noInterrupts();
+		num_encoders++;
+#ifndef ENCODER_USE_INTERRUPTS
+		enc.updated_elsewhere = 1;
+#endif
+		interrupts();
+		return true;
+	}
+	// Add an encoder in adaptive mode, which switches between its pin
+	// interrupts and sampling, depending on speed.  The pins must be
+	// the same as given to the Encoder.
+	bool add(Encoder &enc, uint8_t pin1, uint8_t pin2) {
+		if (!add(enc)) return false;
+#ifdef ENCODER_USE_INTERRUPTS
+		entry_t *e = &list[num_encoders - 1];
+		e->pin1 = pin1;
+		e->pin2 = pin2;
+		e->window_position = enc.encoder.position;
+		e->window_changes = 0;
+		e->peak_edges = 0;
+		e->last_state = enc.encoder.state;
+		noInterrupts();
+		e->adaptive = !e->polled;
+		interrupts();
+#else
+		(void)pin1;
+		(void)pin2;
+#endif
+		return true;
+	}
+	// Start sampling at a fixed rate, in samples per second.  Returns
+	// false if this board has no built-in timer support, in which case
+	// call sample() from your own timer interrupt at this rate.  Only 1
+	// sampler can be started, begin() on a second one returns false.
+	bool begin(uint32_t samples_per_second) {
+		if (samples_per_second == 0) return false;
+		if (active() && active() != this) return false;
+		rate = samples_per_second;
+		active() = this;
+#if defined(TEENSYDUINO) && defined(__arm__)
+		return timer.begin(timer_isr, 1000000.0f / (float)rate);
+#elif defined(ESP32)
+#if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+		timer = timerBegin(1000000);
+		if (!timer) return false;
+		timerAttachInterrupt(timer, timer_isr);
+		timerAlarm(timer, 1000000 / rate, true, 0);
+#else
+		timer = timerBegin(0, 80, true);  // 1 MHz from the 80 MHz APB clock
+		if (!timer) return false;
+		timerAttachInterrupt(timer, timer_isr, true);
+		timerAlarmWrite(timer, 1000000 / rate, true);
+		timerAlarmEnable(timer);
+#endif
+		return true;
+#elif defined(ENCODER_HOST_BUILD)
+		return host_timer_begin(timer_isr);
+#else
+		return false;
+#endif
+	}
+	// Update every encoder once.  Called by the timer, or from your
+	// own timer interrupt.
+	void IRAM_ATTR sample() {
+		uint32_t begin_us = micros();
+		for (uint8_t i=0; i < num_encoders; i++) {
+			entry_t *e = &list[i];
+			if (e->polled) update(e->state);
+#ifdef ENCODER_USE_INTERRUPTS
+			if (e->adaptive && e->state->state != e->last_state) {
+				e->last_state = e->state->state;
+				e->window_changes++;
+			}
+#endif
+		}
+#ifdef ENCODER_USE_INTERRUPTS
+		if (++window >= ENCODER_SAMPLER_WINDOW) {
+			window = 0;
+			for (uint8_t i=0; i < num_encoders; i++) {
+				if (list[i].adaptive) adapt(&list[i]);
+			}
+		}
+#endif
+		uint32_t us = micros() - begin_us;
+		if (us > max_us) max_us = us;
+		count++;
+	}
+	uint32_t sampleRate() { return rate; }
+	uint32_t sampleCount() {
+		noInterrupts();
+		uint32_t ret = count;
+		interrupts();
+		return ret;
+	}
+	// Longest time any call to sample() has taken, in microseconds.
+	// This is measured with micros(), which counts in steps of 4 on
+	// 16 MHz AVR, so short samples there read as 0 or 4.
+	uint32_t maxSampleMicros() {
+		noInterrupts();
+		uint32_t ret = max_us;
+		interrupts();
+		return ret;
+	}
+	void resetMaxSampleMicros() {
+		noInterrupts();
+		max_us = 0;
+		interrupts();
+	}
+	// Number of switches between interrupts and sampling, in adaptive
+	// mode, to help choose the sample rate.
+	uint32_t switchCount() {
+		noInterrupts();
+		uint32_t ret = switches;
+		interrupts();
+		return ret;
+	}
+private:
+	typedef struct {
+		Encoder_internal_state_t * state;
+		int32_t                    window_position;
+		uint16_t                   window_changes;
+		uint32_t                   peak_edges;	// decays 1/8 per window
+		uint8_t                    last_state;
+		uint8_t                    pin1;
+		uint8_t                    pin2;
+		uint8_t                    polled;	// updated by sample()
+		uint8_t                    adaptive;	// may switch modes
+	} entry_t;
+
+#ifdef ENCODER_USE_INTERRUPTS
+	void IRAM_ATTR adapt(entry_t *e) {
+		int32_t position = e->state->position;
+		uint32_t moved = (position >= e->window_position) ?
+			position - e->window_position : e->window_position - position;
+		e->window_position = position;
+		// every counted edge is a pin change, at x1 and x2 the other
+		// pin changes are not counted.  Back and forth motion hardly
+		// changes position, but does change the pins between samples.
+		uint32_t edges = moved * (4 / ENCODER_RESOLUTION);
+		if (e->window_changes > edges) edges = e->window_changes;
+		e->window_changes = 0;
+		e->peak_edges -= e->peak_edges / 8;
+		if (edges > e->peak_edges) e->peak_edges = edges;
+		// sampling needs at least 2 samples per edge, at the highest
+		// edge rate seen lately, not only the average of this window
+		bool nyquist = e->peak_edges * 2 <= ENCODER_SAMPLER_WINDOW;
+		if (!e->polled && nyquist && edges * 4 > ENCODER_SAMPLER_WINDOW) {
+			ENCODER_SAMPLER_LOCK();
+			ENCODER_SAMPLER_IRQ_OFF(e->pin1);
+#if ENCODER_RESOLUTION == 4
+			ENCODER_SAMPLER_IRQ_OFF(e->pin2);
+#endif
+			e->polled = 1;
+			ENCODER_SAMPLER_UNLOCK();
+			switches++;
+		} else if (e->polled && (!nyquist || edges * 8 < ENCODER_SAMPLER_WINDOW)) {
+			ENCODER_SAMPLER_LOCK();
+			update(e->state);
+			e->polled = 0;
+#if ENCODER_RESOLUTION == 4
+			ENCODER_SAMPLER_IRQ_ON(e->pin2, e->state);
+#endif
+			ENCODER_SAMPLER_IRQ_ON(e->pin1, e->state);
+			ENCODER_SAMPLER_UNLOCK();
+			switches++;
+		}
+	}
+#endif
+
+	// The started sampler, 1 for the whole program.
+	static EncoderSampler * & IRAM_ATTR active() {
+		static EncoderSampler * sampler = 0;
+		return sampler;
+	}
+	static void IRAM_ATTR timer_isr() {
+		active()->sample();
+	}
+	entry_t list[ENCODER_SAMPLER_MAX_ENCODERS];
+	volatile uint8_t num_encoders;
+	uint32_t rate;
+	volatile uint32_t max_us;
+	volatile uint32_t count;
+	uint16_t window;
+	volatile uint32_t switches;
+#if defined(TEENSYDUINO) && defined(__arm__)
+	IntervalTimer timer;
+#elif defined(ESP32)
+	hw_timer_t * timer;
+#endif
+};
+
+#endif
@@ -0,0 +1,186 @@
+/* Encoder Library, for measuring quadrature encoded signals
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * EncoderScanner - poll many encoders with one read per port
+ *
+ * With ENCODER_DO_NOT_USE_INTERRUPTS, every Encoder::read() calls
+ * update(), which reads both pins and decodes one encoder.  With many
+ * knobs, EncoderScanner is much faster.  Each GPIO port is read only
+ * once per scan(), and every encoder with both pins on that port is
+ * decoded at the same time, using plain bitwise logic where each bit
+ * of the port register acts as a lane for the encoder whose first pin
+ * is that bit.  Only encoders which actually moved cost any more work,
+ * so scan time grows with the number of ports, not encoders.
+ *
+ * Encoders with pins on different ports (or on boards without a
+ * DIRECT_PORT_READ, or with ENCODER_RESOLUTION 1 or 2) still work,
+ * using the normal update().  So do all encoders with options which
+ * need to see each update (timestamps, events, stats, compare slots,
+ * change notification) or an index pin, since only update() does
+ * that work.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef EncoderScanner_h_
+#define EncoderScanner_h_
+
+#include "Encoder.h"
+
+#ifdef ENCODER_USE_INTERRUPTS
+#error "EncoderScanner requires ENCODER_DO_NOT_USE_INTERRUPTS defined before Encoder.h"
+#endif
+
+// Number of different (port, pin2 - pin1 distance) combinations.  Knobs
+// wired to adjacent pins in the same order all share 1 group per port.
+#ifndef ENCODER_SCANNER_MAX_GROUPS
+#define ENCODER_SCANNER_MAX_GROUPS	4
+#endif
+// Encoders which can't be scanned by port, and use update() instead.
+#ifndef ENCODER_SCANNER_MAX_OTHERS
+#define ENCODER_SCANNER_MAX_OTHERS	4
+#endif
+
+#define ENCODER_SCANNER_LANES	(sizeof(IO_REG_TYPE) * 8)
+
+#if defined(DIRECT_PORT_READ) && ENCODER_RESOLUTION == 4 && \
+  !defined(ENCODER_UPDATE_HOOKS) && !defined(ENCODER_USE_INDEX)
+#define ENCODER_SCANNER_BY_PORT
+#endif
+
+class EncoderScanner
+{
+public:
+	EncoderScanner() : num_groups(0), num_others(0) {
+	}
+	// Add an encoder.  From now on, its read() only returns the
+	// position found by the most recent scan().
+	bool add(Encoder &enc) {
+		Encoder_internal_state_t *s = &enc.encoder;
+#ifdef ENCODER_SCANNER_BY_PORT
+		if (s->pin1_register == s->pin2_register) {
+			int8_t lane1 = lane_of(s->pin1_bitmask);
+			int8_t lane2 = lane_of(s->pin2_bitmask);
+			if (lane1 >= 0 && lane2 >= 0) {
+				group_t *g = find_group(s->pin1_register, lane2 - lane1);
+				if (g) {
+					IO_REG_TYPE bit = (IO_REG_TYPE)1 << lane1;
+					g->lane[lane1] = s;
+					g->lanes |= bit;
+					if (s->state & 1) g->pin1 |= bit;
+					if (s->state & 2) g->pin2 |= bit;
+					enc.updated_elsewhere = 1;
+					return true;
+				}
+			}
+		}
+#endif
+		if (num_others >= ENCODER_SCANNER_MAX_OTHERS) return false;
+		other[num_others++] = s;
+		enc.updated_elsewhere = 1;
+		return true;
+	}
+	// Read every port once and update all encoders.  This is safe to
+	// call from a timer interrupt.
+	void scan() {
+#ifdef ENCODER_SCANNER_BY_PORT
+		volatile IO_REG_TYPE *reg = 0;
+		IO_REG_TYPE port = 0;
+		for (uint8_t i=0; i < num_groups; i++) {
+			group_t *g = &group[i];
+			if (g->reg != reg) {
+				reg = g->reg;
+				port = DIRECT_PORT_READ(reg);
+			}
+			IO_REG_TYPE p1 = port & g->lanes;
+			IO_REG_TYPE p2 = ((g->shift >= 0) ? (port >> g->shift) :
+				(port << -g->shift)) & g->lanes;
+			IO_REG_TYPE d1 = p1 ^ g->pin1;
+			IO_REG_TYPE d2 = p2 ^ g->pin2;
+			IO_REG_TYPE moved = d1 | d2;
+			if (!moved) continue;
+			g->pin1 = p1;
+			g->pin2 = p2;
+			// This is the same table as update(), one lane per bit.
+			// A single step is +1 when pin1 changed and now equals
+			// pin2, or pin2 changed and now differs from pin1.  Both
+			// changing is +2 when they end up equal, otherwise -2
+			// (assume pin1 edges only).
+			IO_REG_TYPE differ = p1 ^ p2;
+			IO_REG_TYPE twice = d1 & d2;
+			IO_REG_TYPE up = ((d1 ^ d2) & (d1 ^ differ)) | (twice & ~differ);
+			do {
+				uint8_t n = __builtin_ctzl((unsigned long)moved);
+				IO_REG_TYPE bit = (IO_REG_TYPE)1 << n;
+				Encoder_internal_state_t *s = g->lane[n];
+				int8_t delta = (twice & bit) ? 2 : 1;
+				s->position += (up & bit) ? delta : -delta;
+				s->state = ((p2 & bit) ? 2 : 0) | ((p1 & bit) ? 1 : 0);
+				moved &= moved - 1;
+			} while (moved);
+		}
+#endif
+		for (uint8_t i=0; i < num_others; i++) {
+			update(other[i]);
+		}
+	}
+private:
+	typedef struct {
+		volatile IO_REG_TYPE *     reg;
+		int8_t                     shift;	// pin2 bit - pin1 bit
+		IO_REG_TYPE                lanes;	// pin1 bit of each encoder
+		IO_REG_TYPE                pin1;	// last pin1, per lane
+		IO_REG_TYPE                pin2;	// last pin2, shifted to its lane
+		Encoder_internal_state_t * lane[ENCODER_SCANNER_LANES];
+	} group_t;
+
+	static int8_t lane_of(IO_REG_TYPE mask) {
+		for (uint8_t n=0; n < ENCODER_SCANNER_LANES; n++) {
+			if (mask == ((IO_REG_TYPE)1 << n)) return n;
+		}
+		return -1;
+	}
+	// Groups on the same port are kept next to each other, so scan()
+	// reads each port only once.
+	group_t * find_group(volatile IO_REG_TYPE *reg, int8_t shift) {
+		uint8_t i, insert = num_groups;
+		for (i=0; i < num_groups; i++) {
+			if (group[i].reg != reg) continue;
+			if (group[i].shift == shift) return &group[i];
+			insert = i + 1;
+		}
+		if (num_groups >= ENCODER_SCANNER_MAX_GROUPS) return 0;
+		for (i=num_groups; i > insert; i--) {
+			group[i] = group[i - 1];
+		}
+		num_groups++;
+		group_t *g = &group[insert];
+		memset(g, 0, sizeof(group_t));
+		g->reg = reg;
+		g->shift = shift;
+		return g;
+	}
+
+	group_t group[ENCODER_SCANNER_MAX_GROUPS];
+	uint8_t num_groups;
+	Encoder_internal_state_t * other[ENCODER_SCANNER_MAX_OTHERS];
+	uint8_t num_others;
+};
+
+#endif
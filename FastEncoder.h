@@ -0,0 +1,146 @@
+/* Encoder Library, for measuring quadrature encoded signals
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * FastEncoder<pin1, pin2> - Encoder with its pins fixed at compile time
+ *
+ * Each FastEncoder pin pair gets its own interrupt function, which
+ * finds its encoder without the interruptArgs table, and reads the pins
+ * with compile time constant registers and bits, where this file knows
+ * the board's pin numbering: Teensy (digitalReadFast) and the ATmega328P
+ * and 168 (Uno, Nano, Pro Mini).  When both pins are in the same port
+ * there, the port is read only once.  On other boards the interrupt
+ * reads the pins like Encoder does.  Everything else is Encoder:
+ * read(), write() and readAndReset() are the same functions, and a
+ * FastEncoder can be added to an EncoderGroup or EncoderSampler.
+ *
+ * Each FastEncoder has its own count.  Only the first one created for
+ * a pin pair uses interrupts, any other on the same pins is updated by
+ * its read(), like an Encoder without interrupt pins.
+ *
+ * Measured on a PC with extras/host/bench.cpp (g++ -O2, both pins on 1
+ * port), update_fast() takes 1.1 to 1.9 ns per edge against 2.4 for
+ * update() with ENCODER_USE_LOOKUP_TABLE, and about the same time with
+ * the default switch decoder, where branch misses dominate.  It has not
+ * been measured on AVR, where Encoder's update() is assembly, and
+ * FastEncoder uses the C decoder with constant pins.
+ *
+ * FastEncoder uses attachInterrupt(), so it can not be used together
+ * with ENCODER_OPTIMIZE_INTERRUPTS.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef FastEncoder_h_
+#define FastEncoder_h_
+
+#include "Encoder.h"
+
+#ifdef ENCODER_OPTIMIZE_INTERRUPTS
+#error "FastEncoder can not be used with ENCODER_OPTIMIZE_INTERRUPTS"
+#endif
+
+// Compile time pin access, on boards where the pin numbering is known.
+//   ENCODER_FAST_READ(pin)   the pin's level, 0 or 1
+// and where ports can be told apart at compile time:
+//   ENCODER_FAST_PORT(pin)   a number for the pin's port
+//   ENCODER_FAST_REG(pin)    the port's input register
+//   ENCODER_FAST_BIT(pin)    the pin's bit in it
+//   ENCODER_FAST_PINS        number of pins
+#if defined(ENCODER_HOST_BUILD)
+#define ENCODER_FAST_PORT(pin)	((pin) >> 5)
+#define ENCODER_FAST_REG(pin)	(host_gpio[(pin) >> 5])
+#define ENCODER_FAST_BIT(pin)	((pin) & 31)
+#define ENCODER_FAST_PINS	(HOST_NUM_PORTS * 32)
+#elif defined(TEENSYDUINO)
+#define ENCODER_FAST_READ(pin)	digitalReadFast(pin)
+#elif defined(__AVR_ATmega328P__) || defined(__AVR_ATmega168__) || defined(__AVR_ATmega8__)
+// 0-7 = PORTD, 8-13 = PORTB, 14-19 (A0-A5) = PORTC
+#define ENCODER_FAST_PORT(pin)	((pin) < 8 ? 0 : (pin) < 14 ? 1 : 2)
+#define ENCODER_FAST_REG(pin)	((pin) < 8 ? PIND : (pin) < 14 ? PINB : PINC)
+#define ENCODER_FAST_BIT(pin)	((pin) < 8 ? (pin) : (pin) < 14 ? (pin) - 8 : (pin) - 14)
+#define ENCODER_FAST_PINS	20
+#endif
+#if defined(ENCODER_FAST_REG) && !defined(ENCODER_FAST_READ)
+#define ENCODER_FAST_READ(pin)	((ENCODER_FAST_REG(pin) >> ENCODER_FAST_BIT(pin)) & 1)
+#endif
+
+template <uint8_t PIN1, uint8_t PIN2>
+class FastEncoder : public Encoder
+{
+public:
+	FastEncoder() : Encoder(PIN1, PIN2, no_attach_t()) {
+#ifdef ENCODER_FAST_PINS
+		static_assert(PIN1 < ENCODER_FAST_PINS && PIN2 < ENCODER_FAST_PINS,
+			"FastEncoder pin number out of range for this board");
+#endif
+#ifdef ENCODER_USE_INTERRUPTS
+#ifdef ENCODER_HARDWARE_COUNTER
+		if (hw_in_use) return;
+#endif
+		if (active) return;
+		active = &encoder;
+#if ENCODER_RESOLUTION == 4
+		interrupts_in_use = attach(PIN1) + attach(PIN2);
+#else
+		interrupts_in_use = attach(PIN1) * 2;
+#endif
+#endif
+	}
+
+	// update() with the pins read at their constant addresses.  Not
+	// meant to be called from sketches.
+	static inline void IRAM_ATTR update_fast(Encoder_internal_state_t *arg) {
+#if defined(ENCODER_FAST_PORT)
+		if (ENCODER_FAST_PORT(PIN1) == ENCODER_FAST_PORT(PIN2)) {
+			IO_REG_TYPE port = ENCODER_FAST_REG(PIN1);
+			update_pins(arg, (port >> ENCODER_FAST_BIT(PIN1)) & 1,
+				(port >> ENCODER_FAST_BIT(PIN2)) & 1);
+		} else {
+			update_pins(arg, ENCODER_FAST_READ(PIN1), ENCODER_FAST_READ(PIN2));
+		}
+#elif defined(ENCODER_FAST_READ)
+		update_pins(arg, ENCODER_FAST_READ(PIN1), ENCODER_FAST_READ(PIN2));
+#else
+		update(arg);
+#endif
+	}
+
+private:
+#ifdef ENCODER_USE_INTERRUPTS
+	// with the same glitch filter, measurement and hooks as Encoder
+	static void IRAM_ATTR isr(void) {
+		isr_run<update_fast>(active);
+	}
+	static uint8_t attach(uint8_t pin) {
+		int irq = digitalPinToInterrupt(pin);
+		if (irq < 0) return 0;
+		attachInterrupt(irq, isr, CHANGE);
+		return 1;
+	}
+	// the FastEncoder which gets this pin pair's interrupts
+	static Encoder_internal_state_t * active;
+#endif
+};
+
+#ifdef ENCODER_USE_INTERRUPTS
+template <uint8_t PIN1, uint8_t PIN2>
+Encoder_internal_state_t * FastEncoder<PIN1, PIN2>::active;
+#endif
+
+#endif
@@ -0,0 +1,34 @@
+/* Encoder Library - AxisGroup Example
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ */
+
+#include <EncoderGroup.h>
+
+// Up to 3 encoders, read together at the same moment.
+EncoderGroup<3> axes;
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println("EncoderGroup Test:");
+  // Change these pin numbers to the pins connected to your encoders.
+  axes.add(2, 3);
+  axes.add(4, 5);
+  axes.add(6, 7);
+}
+
+void loop() {
+  int32_t moved[3];
+  // change of each axis since the last loop, all from the same instant
+  axes.readAndResetAll(moved);
+  if (moved[0] || moved[1] || moved[2]) {
+    Serial.print("X = ");
+    Serial.print(moved[0]);
+    Serial.print(", Y = ");
+    Serial.print(moved[1]);
+    Serial.print(", Z = ");
+    Serial.println(moved[2]);
+  }
+  delay(50);
+}
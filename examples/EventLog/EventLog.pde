@@ -0,0 +1,48 @@
+/* Encoder Library - EventLog Example
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ */
+
+// ENCODER_EVENT_BUFFER_SIZE makes Encoder keep a log of every step,
+// with the time it happened, so the sketch can process motion at full
+// edge rate without calling read() at full edge rate.  It must be
+// defined before Encoder.h is included.
+#define ENCODER_EVENT_BUFFER_SIZE 64
+#include <Encoder.h>
+
+// Change these two numbers to the pins connected to your encoder.
+//   Best Performance: both pins have interrupt capability
+//   (2 and 3 on an Uno).  With fewer, steps are only logged when
+//   read() checks the pins, so keep loop() fast.
+Encoder myEnc(2, 3);
+//   avoid using pins with LEDs attached
+
+Encoder_event_t events[16];
+
+void setup() {
+  Serial.begin(115200);
+  Serial.println("EventLog Encoder Test:");
+}
+
+void loop() {
+  // read() logs any steps on pins without interrupts
+  myEnc.read();
+  uint8_t n = myEnc.readEvents(events, 16);
+  for (uint8_t i=0; i < n; i++) {
+    Serial.print(events[i].time);
+    Serial.print(" us: ");
+    Serial.print(events[i].delta);
+    Serial.print(", pins = ");
+    Serial.println(events[i].pins);
+  }
+  // Steps which did not fit in the buffer are counted, never
+  // silently lost.
+  static uint32_t lost = 0;
+  uint32_t overflows = myEnc.eventOverflows();
+  if (overflows != lost) {
+    lost = overflows;
+    Serial.print("Lost events: ");
+    Serial.println(lost);
+  }
+}
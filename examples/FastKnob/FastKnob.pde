@@ -0,0 +1,28 @@
+/* Encoder Library - FastKnob Example
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ */
+
+#include <FastEncoder.h>
+
+// The pin numbers are template parameters, so each FastEncoder gets
+// its own interrupt function.  Both pins should have interrupt
+// capability, and ideally be on the same port.
+FastEncoder<2, 3> myEnc;
+//   avoid using pins with LEDs attached
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println("FastEncoder Test:");
+}
+
+long oldPosition  = -999;
+
+void loop() {
+  long newPosition = myEnc.read();
+  if (newPosition != oldPosition) {
+    oldPosition = newPosition;
+    Serial.println(newPosition);
+  }
+}
@@ -0,0 +1,36 @@
+/* Encoder Library - IndexPulse Example
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ */
+
+#define ENCODER_USE_INDEX
+#include <Encoder.h>
+
+// Change these pin numbers to the pins connected to your encoder.
+// The third pin is the index (Z) output, pulsing once per revolution.
+Encoder myEnc(2, 3, 4);
+//   avoid using pins with LEDs attached
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println("Encoder Index Test:");
+  // home: every index pulse sets the position to zero
+  myEnc.setIndexReset(true, 0);
+}
+
+uint32_t oldCount = 0;
+
+void loop() {
+  uint32_t count = myEnc.indexCount();
+  if (count != oldCount) {
+    oldCount = count;
+    Serial.print("Index at ");
+    Serial.print(myEnc.indexPosition());
+    if (count >= 2) {
+      Serial.print(", counts/rev = ");
+      Serial.print(myEnc.countsPerRevolution());
+    }
+    Serial.println();
+  }
+}
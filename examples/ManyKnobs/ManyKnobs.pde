@@ -0,0 +1,50 @@
+/* Encoder Library - ManyKnobs Example
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ */
+
+// EncoderScanner polls many encoders without interrupts.  Each port is
+// read once per scan(), and all encoders on that port are decoded
+// together, so dozens of knobs cost little more than a few.  For the
+// best speed, wire both pins of each knob to the same port, in the
+// same order (eg, pin1 on an even bit, pin2 on the next bit).
+#define ENCODER_DO_NOT_USE_INTERRUPTS
+#include <Encoder.h>
+#include <EncoderScanner.h>
+
+// Change these pin numbers to the pins connected to your encoders.
+Encoder knob[4] = {
+  Encoder(0, 1),
+  Encoder(2, 3),
+  Encoder(4, 5),
+  Encoder(6, 7)
+};
+//   avoid using pins with LEDs attached
+
+EncoderScanner scanner;
+long position[4] = {-999, -999, -999, -999};
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println("ManyKnobs Encoder Test:");
+  for (int i=0; i < 4; i++) {
+    scanner.add(knob[i]);
+  }
+}
+
+void loop() {
+  // Like any polling, scan() must be called rapidly, or fast motion
+  // will be missed.  It may also be called from a timer interrupt.
+  scanner.scan();
+  for (int i=0; i < 4; i++) {
+    long newPos = knob[i].read();
+    if (newPos != position[i]) {
+      position[i] = newPos;
+      Serial.print("Knob ");
+      Serial.print(i);
+      Serial.print(" = ");
+      Serial.println(newPos);
+    }
+  }
+}
@@ -0,0 +1,45 @@
+/* Encoder Library - PinChangeKnobs Example
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ */
+
+// On AVR boards like Uno, only pins 2 and 3 have external interrupts.
+// ENCODER_USE_PCINT lets every other pin use a pin change interrupt,
+// so all 6 knobs count in interrupt mode, even during delay().
+// SoftwareSerial can't be used together with it.
+#define ENCODER_USE_PCINT
+#include <Encoder.h>
+
+Encoder knob1(2, 3);     // INT0, INT1
+Encoder knob2(4, 5);     // pin change group 2 (pins 0-7)
+Encoder knob3(6, 7);
+Encoder knob4(8, 9);     // pin change group 0 (pins 8-13)
+Encoder knob5(10, 11);
+Encoder knob6(A0, A1);   // pin change group 1 (A0-A5)
+//   avoid using pins with LEDs attached
+
+Encoder *knobs[6] = {&knob1, &knob2, &knob3, &knob4, &knob5, &knob6};
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println("PinChangeKnobs Encoder Test:");
+  // each pin change group takes up to ENCODER_PCINT_MAX_PER_GROUP
+  // encoders (default 4), more only count while read() is called
+  for (int i=0; i < 6; i++) {
+    if (!knobs[i]->interruptsAttached()) {
+      Serial.print("knob");
+      Serial.print(i + 1);
+      Serial.println(" has no interrupt, it can lose counts");
+    }
+  }
+}
+
+void loop() {
+  for (int i=0; i < 6; i++) {
+    Serial.print(knobs[i]->read());
+    Serial.print(i < 5 ? "\t" : "\n");
+  }
+  // a slow loop doesn't lose counts
+  delay(250);
+}
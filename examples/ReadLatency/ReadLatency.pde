@@ -0,0 +1,68 @@
+/* Encoder Library - ReadLatency - for measuring read() overhead
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ */
+
+// Every read(), readAndReset() and write() must get a consistent
+// 32 bit position, while an interrupt may be changing it.  On 8 bit
+// AVR, and 32 bit chips without atomic exchange (Cortex-M0, ESP8266),
+// this is done by disabling interrupts for the duration of the access,
+// which delays any other interrupt by up to that long.  On Cortex-M3
+// and up, and ESP32, Encoder uses atomic loads, stores and exchange,
+// so interrupts are never disabled when both pins have interrupts.
+//
+// This measures the time each function takes, per call.  It does not
+// measure interrupt latency.  With noInterrupts(), an interrupt which
+// arrives during a call can wait up to about the call time, and with
+// lock free access it does not wait at all.  To see the actual delay,
+// toggle a pin in ENCODER_ISR_ENTRY() and watch it on a scope against
+// the encoder pins.
+
+#include <Encoder.h>
+
+// Use 2 pins with interrupt capability.  If either pin lacks it, read()
+// must update from the pins itself, which always disables interrupts.
+Encoder myEnc(2, 3);
+
+const unsigned long count = 100000;
+
+void setup() {
+  Serial.begin(9600);
+  while (!Serial && millis() < 3000) ; // wait for Arduino Serial Monitor
+  Serial.println("Encoder read() call time test:");
+#ifdef ENCODER_LOCK_FREE_READ
+  Serial.println("This board uses lock free access");
+#else
+  Serial.println("This board disables interrupts in each access");
+#endif
+
+  volatile long sum = 0;
+  unsigned long begin = micros();
+  for (unsigned long i=0; i < count; i++) {
+    sum = sum + myEnc.read();
+  }
+  report("read()", micros() - begin);
+
+  begin = micros();
+  for (unsigned long i=0; i < count; i++) {
+    sum = sum + myEnc.readAndReset();
+  }
+  report("readAndReset()", micros() - begin);
+
+  begin = micros();
+  for (unsigned long i=0; i < count; i++) {
+    myEnc.write(i);
+  }
+  report("write()", micros() - begin);
+}
+
+void report(const char *name, unsigned long us) {
+  Serial.print(name);
+  Serial.print(" call time: ");
+  Serial.print(us * 1000.0 / count);
+  Serial.println(" ns");
+}
+
+void loop() {
+}
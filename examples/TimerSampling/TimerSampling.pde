@@ -0,0 +1,42 @@
+/* Encoder Library - TimerSampling Example
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ */
+
+// EncoderSampler polls encoders from a timer interrupt, so pins without
+// interrupt capability still count correctly, even when the sketch is
+// busy with delay() or slow Serial printing.  The sample rate must be
+// faster than the fastest rate the encoder signals can change.
+#define ENCODER_DO_NOT_USE_INTERRUPTS
+#include <Encoder.h>
+#include <EncoderSampler.h>
+
+// Change these two numbers to the pins connected to your encoder.
+Encoder myEnc(5, 6);
+//   avoid using pins with LEDs attached
+
+EncoderSampler sampler;
+
+void setup() {
+  Serial.begin(9600);
+  Serial.println("TimerSampling Encoder Test:");
+  sampler.add(myEnc);
+  if (!sampler.begin(20000)) {
+    // No built-in timer on this board.  Call sampler.sample()
+    // from your own 20 kHz timer interrupt instead.
+    Serial.println("Please call sampler.sample() from a timer");
+  }
+}
+
+void loop() {
+  Serial.print("Position = ");
+  Serial.print(myEnc.read());
+  Serial.print(", samples/sec = ");
+  Serial.print(sampler.sampleRate());
+  Serial.print(", worst sample time = ");
+  Serial.print(sampler.maxSampleMicros());
+  Serial.println(" us");
+  // A long delay no longer causes missed steps.
+  delay(500);
+}
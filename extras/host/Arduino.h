@@ -0,0 +1,127 @@
+/* Encoder Library - minimal Arduino API for host (Linux) builds
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This lets Encoder.h compile with a normal g++ on a PC, so the decoder
+ * can be benchmarked and exercised before anything is flashed.  Pins are
+ * bits in 4 fake 32 bit input registers (pins 0 to 127).  Pins 0 to 7
+ * can have an "interrupt" attached, which host_pin_write() calls
+ * synchronously, as if the hardware had triggered it.
+ *
+ * Compile tools with -DARDUINO=100 and -I pointing to this directory,
+ * so Encoder.h picks up this file instead of the real Arduino.h.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#define ENCODER_HOST_BUILD
+
+#define INPUT		0x0
+#define OUTPUT		0x1
+#define INPUT_PULLUP	0x2
+#define LOW		0x0
+#define HIGH		0x1
+#define CHANGE		1
+#define FALLING		2
+#define RISING		3
+#define NOT_AN_INTERRUPT	-1
+
+#define HOST_NUM_PORTS		4
+#define HOST_NUM_INTERRUPTS	8
+
+static volatile uint32_t host_gpio[HOST_NUM_PORTS];
+static void (*host_isr[HOST_NUM_INTERRUPTS])(void);
+static void (*host_isr_arg[HOST_NUM_INTERRUPTS])(void *);
+static void *host_isr_param[HOST_NUM_INTERRUPTS];
+static uint8_t host_isr_mode[HOST_NUM_INTERRUPTS];
+
+#define digitalPinToPort(pin)		((pin) >> 5)
+#define digitalPinToBitMask(pin)	((uint32_t)1 << ((pin) & 31))
+#define portInputRegister(port)		(&host_gpio[(port)])
+#define digitalPinToInterrupt(pin)	((pin) < HOST_NUM_INTERRUPTS ? (pin) : NOT_AN_INTERRUPT)
+
+static inline void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+static inline void digitalWrite(uint8_t pin, uint8_t val) { (void)pin; (void)val; }
+static inline int digitalRead(uint8_t pin)
+{
+	return (host_gpio[digitalPinToPort(pin)] & digitalPinToBitMask(pin)) ? HIGH : LOW;
+}
+
+// Interrupts are simulated synchronously, so there is nothing to mask.
+static inline void noInterrupts(void) { }
+static inline void interrupts(void) { }
+static inline void yield(void) { }
+
+static inline void attachInterrupt(uint8_t num, void (*func)(void), int mode)
+{
+	if (num >= HOST_NUM_INTERRUPTS) return;
+	host_isr[num] = func;
+	host_isr_mode[num] = mode;
+}
+
+static inline void attachInterruptArg(uint8_t num, void (*func)(void *), void *arg, int mode)
+{
+	if (num >= HOST_NUM_INTERRUPTS) return;
+	host_isr_arg[num] = func;
+	host_isr_param[num] = arg;
+	host_isr_mode[num] = mode;
+}
+
+static inline void detachInterrupt(uint8_t num)
+{
+	if (num >= HOST_NUM_INTERRUPTS) return;
+	host_isr[num] = NULL;
+	host_isr_arg[num] = NULL;
+}
+
+static inline uint32_t micros(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+static inline uint32_t millis(void)
+{
+	return micros() / 1000;
+}
+
+static inline void delayMicroseconds(unsigned int us) { (void)us; }
+
+// Drive a simulated input pin, and run its interrupt if one is attached
+// and the edge matches the attached mode.
+static inline void host_pin_write(uint8_t pin, uint8_t val)
+{
+	volatile uint32_t *reg = portInputRegister(digitalPinToPort(pin));
+	uint32_t mask = digitalPinToBitMask(pin);
+	uint8_t old = (*reg & mask) ? HIGH : LOW;
+	if (val) *reg |= mask; else *reg &= ~mask;
+	if (old == val || pin >= HOST_NUM_INTERRUPTS) return;
+	uint8_t mode = host_isr_mode[pin];
+	if (mode == CHANGE || (mode == RISING && val) || (mode == FALLING && !val)) {
+		if (host_isr[pin]) host_isr[pin]();
+		if (host_isr_arg[pin]) host_isr_arg[pin](host_isr_param[pin]);
+	}
+}
+
+// A periodic timer interrupt, for EncoderSampler.  host_timer_tick()
+// runs it, as if the timer had fired.
+static void (*host_timer_isr)(void);
+
+static inline bool host_timer_begin(void (*func)(void))
+{
+	host_timer_isr = func;
+	return true;
+}
+
+static inline void host_timer_tick(void)
+{
+	if (host_timer_isr) host_timer_isr();
+}
+
+#endif
@@ -0,0 +1,128 @@
+/* Encoder Library - minimal ATmega328P (Uno) Arduino API for host builds
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * Like ../Arduino.h, but with the Uno's pins, so the AVR code paths
+ * can run on a PC: ENCODER_USE_PCINT, and ENCODER_OPTIMIZE_INTERRUPTS.
+ * Pins are bits in fake PIND, PINB and PINC registers.  Pins 2 and 3
+ * have external interrupts, INT0 and INT1, and every pin has a pin
+ * change interrupt, in 3 groups.  host_pin_write() runs whichever of
+ * them are enabled, synchronously, as if the hardware had triggered it.
+ *
+ * The assembly update() can't run on the host, so compile with an
+ * option which needs the C version, for example ENCODER_USE_STATS.
+ * Compile with -DARDUINO=100, and -I pointing to this directory.
+ */
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#include "avr/io.h"
+#include "avr/interrupt.h"
+
+#define INPUT		0x0
+#define OUTPUT		0x1
+#define INPUT_PULLUP	0x2
+#define LOW		0x0
+#define HIGH		0x1
+#define CHANGE		1
+#define FALLING		2
+#define RISING		3
+#define NOT_AN_INTERRUPT	-1
+
+#define A0	14
+#define A1	15
+#define A2	16
+#define A3	17
+#define A4	18
+#define A5	19
+
+#define digitalPinToPort(p)		((p) < 8 ? 0 : ((p) < 14 ? 1 : 2))
+#define digitalPinToBitMask(p)		((uint8_t)_BV((p) < 8 ? (p) : ((p) < 14 ? (p) - 8 : (p) - 14)))
+#define portInputRegister(port)		(&host_avr_pin[(port)])
+#define digitalPinToInterrupt(p)	((p) == 2 ? 0 : ((p) == 3 ? 1 : NOT_AN_INTERRUPT))
+#define digitalPinToPCICR(p)		(((p) >= 0 && (p) <= 19) ? (&PCICR) : ((volatile uint8_t *)0))
+#define digitalPinToPCICRbit(p)		(((p) <= 7) ? 2 : (((p) <= 13) ? 0 : 1))
+#define digitalPinToPCMSK(p)		(&host_avr_pcmsk[digitalPinToPCICRbit(p)])
+#define digitalPinToPCMSKbit(p)		(((p) <= 7) ? (p) : (((p) <= 13) ? ((p) - 8) : ((p) - 14)))
+
+static inline void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+static inline void digitalWrite(uint8_t pin, uint8_t val) { (void)pin; (void)val; }
+static inline int digitalRead(uint8_t pin)
+{
+	return (*portInputRegister(digitalPinToPort(pin)) & digitalPinToBitMask(pin)) ? HIGH : LOW;
+}
+
+static inline void noInterrupts(void) { cli(); }
+static inline void interrupts(void) { sei(); }
+static inline void yield(void) { }
+
+// attachInterrupt() keeps the function, ENCODER_OPTIMIZE_INTERRUPTS
+// replaces it with EICRA and EIMSK, and ISR(INTn_vect).
+static void (*host_isr[2])(void);
+
+static inline void attachInterrupt(uint8_t num, void (*func)(void), int mode)
+{
+	if (num >= 2) return;
+	host_isr[num] = func;
+	EICRA = (EICRA & ~(3 << (num * 2))) | (mode << (num * 2));
+	EIMSK |= _BV(num);
+}
+
+static inline void detachInterrupt(uint8_t num)
+{
+	if (num >= 2) return;
+	EIMSK &= ~_BV(num);
+	host_isr[num] = NULL;
+}
+
+static inline uint32_t micros(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+static inline uint32_t millis(void)
+{
+	return micros() / 1000;
+}
+
+static inline void delayMicroseconds(unsigned int us) { (void)us; }
+
+// Number of times each pin change vector ran.
+static uint32_t host_pcint_calls[3];
+
+// Drive a simulated input pin, and run its external interrupt if it's
+// enabled for this edge, and its group's pin change interrupt if this
+// pin is enabled in the group's mask.
+static inline void host_pin_write(uint8_t pin, uint8_t val)
+{
+	volatile uint8_t *reg = portInputRegister(digitalPinToPort(pin));
+	uint8_t mask = digitalPinToBitMask(pin);
+	uint8_t old = (*reg & mask) ? HIGH : LOW;
+	if (val) *reg |= mask; else *reg &= ~mask;
+	if (old == val) return;
+	int num = digitalPinToInterrupt(pin);
+	if (num != NOT_AN_INTERRUPT && (EIMSK & _BV(num))) {
+		uint8_t mode = (EICRA >> (num * 2)) & 3;
+		if (mode == CHANGE || (mode == RISING && val) || (mode == FALLING && !val)) {
+			if (host_isr[num]) host_isr[num]();
+			else if (num == 0 && host_int0_vect) host_int0_vect();
+			else if (num == 1 && host_int1_vect) host_int1_vect();
+		}
+	}
+	uint8_t group = digitalPinToPCICRbit(pin);
+	if ((PCICR & _BV(group)) && (*digitalPinToPCMSK(pin) & _BV(digitalPinToPCMSKbit(pin)))) {
+		host_pcint_calls[group]++;
+		if (group == 0 && host_pcint0_vect) host_pcint0_vect();
+		if (group == 1 && host_pcint1_vect) host_pcint1_vect();
+		if (group == 2 && host_pcint2_vect) host_pcint2_vect();
+	}
+}
+
+#endif
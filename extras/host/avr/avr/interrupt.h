@@ -0,0 +1,15 @@
+/* Encoder Library - fake avr/interrupt.h for host builds, see ../Arduino.h */
+
+#ifndef host_avr_interrupt_h_
+#define host_avr_interrupt_h_
+
+#include "io.h"
+
+#define ISR(vector)	extern "C" void vector(void)
+
+// Interrupts are simulated synchronously, so there is nothing to mask,
+// but the I bit in SREG follows, for checks of what the code leaves.
+static inline void cli(void) { SREG &= ~0x80; }
+static inline void sei(void) { SREG |= 0x80; }
+
+#endif
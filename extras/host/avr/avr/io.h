@@ -0,0 +1,39 @@
+/* Encoder Library - fake avr/io.h for host builds, see ../Arduino.h */
+
+#ifndef host_avr_io_h_
+#define host_avr_io_h_
+
+#include <stdint.h>
+
+#define _BV(bit)	(1 << (bit))
+
+// ATmega328P: port D is pins 0-7, B is 8-13, C is A0-A5
+static volatile uint8_t host_avr_pin[3];
+#define PIND		host_avr_pin[0]
+#define PINB		host_avr_pin[1]
+#define PINC		host_avr_pin[2]
+
+static volatile uint8_t host_avr_sreg, host_avr_eicra, host_avr_eimsk;
+static volatile uint8_t host_avr_pcicr, host_avr_pcmsk[3];
+#define SREG		host_avr_sreg
+#define EICRA		host_avr_eicra
+#define EIMSK		host_avr_eimsk
+#define PCICR		host_avr_pcicr
+#define PCMSK0		host_avr_pcmsk[0]
+#define PCMSK1		host_avr_pcmsk[1]
+#define PCMSK2		host_avr_pcmsk[2]
+
+// The vectors are plain functions, which host_pin_write() calls if
+// something defined them with ISR().
+#define INT0_vect	host_int0_vect
+#define INT1_vect	host_int1_vect
+#define PCINT0_vect	host_pcint0_vect
+#define PCINT1_vect	host_pcint1_vect
+#define PCINT2_vect	host_pcint2_vect
+extern "C" void host_int0_vect(void) __attribute__((weak));
+extern "C" void host_int1_vect(void) __attribute__((weak));
+extern "C" void host_pcint0_vect(void) __attribute__((weak));
+extern "C" void host_pcint1_vect(void) __attribute__((weak));
+extern "C" void host_pcint2_vect(void) __attribute__((weak));
+
+#endif
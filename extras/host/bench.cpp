@@ -0,0 +1,173 @@
+/* Encoder Library - host benchmark of the update() decoder
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ *
+ * Feeds synthetic quadrature patterns through update() on a PC, and
+ * reports the time per call, throughput and (where the kernel allows
+ * perf counters) the branch miss rate, for update() and for the
+ * FastEncoder interrupt's update_fast() on the same pins.  Use it to compare decoder
+ * changes before flashing a board.  Absolute numbers are for the PC,
+ * of course, but relative differences usually carry over.
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -DARDUINO=100 -I. -I../.. bench.cpp -o bench && ./bench
+ *
+ * Add any Encoder option on the command line, for example
+ * -DENCODER_DO_NOT_USE_INTERRUPTS, to measure that configuration.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "FastEncoder.h"
+
+#define NUM_SAMPLES	2000000
+#define NUM_RUNS	5
+
+// Pin1 is bit 0 and pin2 is bit 1 of the first fake port.
+// Stepping through this table moves the position +1 per step.
+static const uint32_t forward[4] = {0, 2, 3, 1};
+
+static uint32_t lcg = 12345;
+static uint32_t random_bit(void)
+{
+	lcg = lcg * 1103515245 + 12345;
+	return (lcg >> 16) & 1;
+}
+
+// Steady motion in one direction, 1 edge per sample.
+static long pattern_steady(uint32_t *buf, long n)
+{
+	for (long i=0; i < n; i++) buf[i] = forward[(i + 1) & 3];
+	return n;
+}
+
+// A random walk, which reverses on roughly half of all edges.
+static long pattern_reversing(uint32_t *buf, long n)
+{
+	long pos = 0;
+	for (long i=0; i < n; i++) {
+		pos += random_bit() ? 1 : -1;
+		buf[i] = forward[pos & 3];
+	}
+	return pos;
+}
+
+// Steady motion where every edge bounces once before it settles,
+// so 3 samples (each one a real pin change) per step.
+static long pattern_bouncing(uint32_t *buf, long n)
+{
+	long pos = 0, i = 0;
+	while (i + 3 <= n) {
+		buf[i++] = forward[(pos + 1) & 3];
+		buf[i++] = forward[pos & 3];
+		buf[i++] = forward[(pos + 1) & 3];
+		pos++;
+	}
+	while (i < n) buf[i++] = forward[pos & 3];
+	return pos;
+}
+
+static int perf_open(uint64_t config, int group)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = config;
+	attr.disabled = (group < 0);
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static uint64_t perf_value(int fd)
+{
+	uint64_t val = 0;
+	if (fd < 0 || read(fd, &val, sizeof(val)) != sizeof(val)) return 0;
+	return val;
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+template <void (*UPDATE)(Encoder_internal_state_t *)>
+static void run(const char *name, long (*pattern)(uint32_t *, long))
+{
+	uint32_t *buf = (uint32_t *)malloc(NUM_SAMPLES * sizeof(uint32_t));
+	long expected = pattern(buf, NUM_SAMPLES);
+	double best = 1e30;
+	uint64_t branches = 0, misses = 0;
+	int fd_br = perf_open(PERF_COUNT_HW_BRANCH_INSTRUCTIONS, -1);
+	int fd_miss = (fd_br >= 0) ? perf_open(PERF_COUNT_HW_BRANCH_MISSES, fd_br) : -1;
+
+	for (int r=0; r < NUM_RUNS; r++) {
+		Encoder_internal_state_t enc;
+		memset(&enc, 0, sizeof(enc));
+		enc.pin1_register = PIN_TO_BASEREG(0);
+		enc.pin2_register = PIN_TO_BASEREG(1);
+		enc.pin1_bitmask = PIN_TO_BITMASK(0);
+		enc.pin2_bitmask = PIN_TO_BITMASK(1);
+		host_gpio[0] = forward[0];
+		enc.state = forward[0];
+		if (fd_br >= 0) {
+			ioctl(fd_br, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+			ioctl(fd_br, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+		}
+		double t = now_ns();
+		for (long i=0; i < NUM_SAMPLES; i++) {
+			host_gpio[0] = buf[i];
+			UPDATE(&enc);
+		}
+		t = now_ns() - t;
+		if (fd_br >= 0) {
+			ioctl(fd_br, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+		}
+		if (enc.position != expected) {
+			printf("%-10s  FAIL: position %ld, expected %ld\n",
+				name, (long)enc.position, expected);
+			exit(1);
+		}
+		if (t < best) {
+			best = t;
+			branches = perf_value(fd_br);
+			misses = perf_value(fd_miss);
+		}
+	}
+	printf("%-10s  %8.2f ns/edge  %8.1f Medges/s", name,
+		best / NUM_SAMPLES, NUM_SAMPLES * 1e3 / best);
+	if (branches) {
+		printf("  %6.2f%% branch miss  %5.2f branches/edge\n",
+			100.0 * misses / branches, (double)branches / NUM_SAMPLES);
+	} else {
+		printf("  (no perf counters)\n");
+	}
+	if (fd_miss >= 0) close(fd_miss);
+	if (fd_br >= 0) close(fd_br);
+	free(buf);
+}
+
+int main(void)
+{
+	printf("Encoder update() host benchmark, %d edges per run, best of %d\n",
+		NUM_SAMPLES, NUM_RUNS);
+	printf("update():\n");
+	run<update>("steady", pattern_steady);
+	run<update>("reversing", pattern_reversing);
+	run<update>("bouncing", pattern_bouncing);
+	printf("FastEncoder<0, 1>::update_fast():\n");
+	run<FastEncoder<0, 1>::update_fast>("steady", pattern_steady);
+	run<FastEncoder<0, 1>::update_fast>("reversing", pattern_reversing);
+	run<FastEncoder<0, 1>::update_fast>("bouncing", pattern_bouncing);
+	return 0;
+}
@@ -0,0 +1,209 @@
+/* Encoder Library - fake ESP-IDF 5 pulse counter driver for host builds
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * Just enough of driver/pulse_cnt.h for utility/hardware_counter.h,
+ * with a software model of the PCNT units, so pcnt.cpp can check how
+ * the backend configures them.  Drive pins with host_pcnt_pin_write(),
+ * which applies every running channel's edge and level actions, like
+ * the hardware, and then host_pin_write().  Units count 16 bits
+ * between low_limit and high_limit, and go back to 0 at either one.
+ * With accum_count, and a watch point at that limit, the driver adds
+ * the limit to a software total, which pcnt_unit_get_count() includes.
+ */
+
+#ifndef host_pulse_cnt_h_
+#define host_pulse_cnt_h_
+
+#include "Arduino.h"
+
+#ifndef HOST_PCNT_UNITS
+#define HOST_PCNT_UNITS		2
+#endif
+#define HOST_PCNT_CHANNELS	2	// per unit
+
+typedef int esp_err_t;
+#define ESP_OK			0
+#define ESP_ERR_INVALID_ARG	0x102
+#define ESP_ERR_INVALID_STATE	0x103
+#define ESP_ERR_NOT_FOUND	0x105
+
+typedef enum {
+	PCNT_CHANNEL_EDGE_ACTION_HOLD,
+	PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+	PCNT_CHANNEL_EDGE_ACTION_DECREASE,
+} pcnt_channel_edge_action_t;
+
+typedef enum {
+	PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+	PCNT_CHANNEL_LEVEL_ACTION_INVERSE,
+	PCNT_CHANNEL_LEVEL_ACTION_HOLD,
+} pcnt_channel_level_action_t;
+
+typedef struct {
+	int low_limit;
+	int high_limit;
+	int intr_priority;
+	struct {
+		uint32_t accum_count: 1;
+	} flags;
+} pcnt_unit_config_t;
+
+typedef struct {
+	int edge_gpio_num;
+	int level_gpio_num;
+	struct {
+		uint32_t invert_edge_input: 1;
+		uint32_t invert_level_input: 1;
+	} flags;
+} pcnt_chan_config_t;
+
+struct pcnt_unit_t;
+
+struct pcnt_chan_t {
+	struct pcnt_unit_t *unit;
+	int edge_gpio, level_gpio;
+	pcnt_channel_edge_action_t pos, neg;
+	pcnt_channel_level_action_t high, low;
+};
+
+struct pcnt_unit_t {
+	bool used, enabled, running, accum, watch_low, watch_high;
+	int low_limit, high_limit;
+	int count;		// the hardware counter
+	int total;		// the driver's accumulated overflows
+	struct pcnt_chan_t chan[HOST_PCNT_CHANNELS];
+	uint8_t num_chan;
+};
+
+typedef struct pcnt_unit_t * pcnt_unit_handle_t;
+typedef struct pcnt_chan_t * pcnt_channel_handle_t;
+
+static struct pcnt_unit_t host_pcnt_unit[HOST_PCNT_UNITS];
+
+static inline esp_err_t pcnt_new_unit(const pcnt_unit_config_t *config, pcnt_unit_handle_t *ret)
+{
+	if (config->low_limit >= 0 || config->high_limit <= 0 ||
+	  config->low_limit < -32768 || config->high_limit > 32767) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	for (int i=0; i < HOST_PCNT_UNITS; i++) {
+		struct pcnt_unit_t *u = &host_pcnt_unit[i];
+		if (u->used) continue;
+		memset(u, 0, sizeof(*u));
+		u->used = true;
+		u->accum = config->flags.accum_count;
+		u->low_limit = config->low_limit;
+		u->high_limit = config->high_limit;
+		*ret = u;
+		return ESP_OK;
+	}
+	return ESP_ERR_NOT_FOUND;
+}
+
+static inline esp_err_t pcnt_del_unit(pcnt_unit_handle_t unit)
+{
+	if (unit->num_chan || unit->enabled) return ESP_ERR_INVALID_STATE;
+	unit->used = false;
+	return ESP_OK;
+}
+
+static inline esp_err_t pcnt_new_channel(pcnt_unit_handle_t unit,
+  const pcnt_chan_config_t *config, pcnt_channel_handle_t *ret)
+{
+	if (unit->num_chan >= HOST_PCNT_CHANNELS) return ESP_ERR_NOT_FOUND;
+	struct pcnt_chan_t *c = &unit->chan[unit->num_chan++];
+	memset(c, 0, sizeof(*c));
+	c->unit = unit;
+	c->edge_gpio = config->edge_gpio_num;
+	c->level_gpio = config->level_gpio_num;
+	*ret = c;
+	return ESP_OK;
+}
+
+static inline esp_err_t pcnt_del_channel(pcnt_channel_handle_t chan)
+{
+	chan->unit->num_chan--;
+	return ESP_OK;
+}
+
+static inline esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t chan,
+  pcnt_channel_edge_action_t pos_act, pcnt_channel_edge_action_t neg_act)
+{
+	chan->pos = pos_act;
+	chan->neg = neg_act;
+	return ESP_OK;
+}
+
+static inline esp_err_t pcnt_channel_set_level_action(pcnt_channel_handle_t chan,
+  pcnt_channel_level_action_t high_act, pcnt_channel_level_action_t low_act)
+{
+	chan->high = high_act;
+	chan->low = low_act;
+	return ESP_OK;
+}
+
+static inline esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t unit, int value)
+{
+	if (value == unit->low_limit) unit->watch_low = true;
+	else if (value == unit->high_limit) unit->watch_high = true;
+	else if (value < unit->low_limit || value > unit->high_limit) return ESP_ERR_INVALID_ARG;
+	return ESP_OK;
+}
+
+static inline esp_err_t pcnt_unit_enable(pcnt_unit_handle_t unit)
+{
+	unit->enabled = true;
+	return ESP_OK;
+}
+
+static inline esp_err_t pcnt_unit_start(pcnt_unit_handle_t unit)
+{
+	if (!unit->enabled) return ESP_ERR_INVALID_STATE;
+	unit->running = true;
+	return ESP_OK;
+}
+
+static inline esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unit)
+{
+	unit->count = 0;
+	unit->total = 0;
+	return ESP_OK;
+}
+
+static inline esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unit, int *value)
+{
+	*value = unit->total + unit->count;
+	return ESP_OK;
+}
+
+// Drive a pin, counting its edge in every running unit, as the PCNT
+// hardware would, then update the pin (and run its interrupt).
+static inline void host_pcnt_pin_write(uint8_t pin, uint8_t val)
+{
+	if (digitalRead(pin) != val) {
+		for (int i=0; i < HOST_PCNT_UNITS; i++) {
+			struct pcnt_unit_t *u = &host_pcnt_unit[i];
+			if (!u->running) continue;
+			for (int n=0; n < u->num_chan; n++) {
+				struct pcnt_chan_t *c = &u->chan[n];
+				if (c->edge_gpio != pin) continue;
+				int action = val ? c->pos : c->neg;
+				int level = digitalRead(c->level_gpio) ? c->high : c->low;
+				if (level == PCNT_CHANNEL_LEVEL_ACTION_HOLD) continue;
+				int step = (action == PCNT_CHANNEL_EDGE_ACTION_INCREASE) ? 1 :
+					(action == PCNT_CHANNEL_EDGE_ACTION_DECREASE) ? -1 : 0;
+				if (level == PCNT_CHANNEL_LEVEL_ACTION_INVERSE) step = -step;
+				u->count += step;
+				if (u->count == u->high_limit || u->count == u->low_limit) {
+					bool watched = (u->count == u->high_limit) ?
+						u->watch_high : u->watch_low;
+					if (u->accum && watched) u->total += u->count;
+					u->count = 0;
+				}
+			}
+		}
+	}
+	host_pin_write(pin, val);
+}
+
+#endif
@@ -0,0 +1,8 @@
+/* Encoder Library - fake ESP-IDF soc_caps.h for host builds, see pcnt.cpp */
+
+#ifndef host_soc_caps_h_
+#define host_soc_caps_h_
+
+#define SOC_PCNT_SUPPORTED	1
+
+#endif
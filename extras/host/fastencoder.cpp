@@ -0,0 +1,100 @@
+/* Encoder Library - host check of FastEncoder
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ *
+ * 3 FastEncoders: 1 with both pins on 1 port, a second on the same
+ * pins (which must keep its own count, updated by read()), and 1 with
+ * pins on 2 ports.  They follow random single steps, and each read()
+ * must equal the true count.  The interrupt must pass through
+ * ENCODER_ISR_ENTRY() and ENCODER_ISR_EXIT() once per edge, and with
+ * ENCODER_ISR_INSTRUMENTATION, isrStats() must count every edge.
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -DARDUINO=100 -I. -I../.. fastencoder.cpp -o fastencoder && ./fastencoder
+ *
+ * Also check with -DENCODER_ISR_INSTRUMENTATION, -DENCODER_RESOLUTION=2
+ * or 1, and -DENCODER_DO_NOT_USE_INTERRUPTS.
+ */
+
+#include <stdio.h>
+
+static unsigned long isr_entries, isr_exits;
+#define ENCODER_ISR_ENTRY(arg)	isr_entries++
+#define ENCODER_ISR_EXIT(arg)	isr_exits++
+#include "FastEncoder.h"
+
+#define NUM_STEPS	100000
+
+FastEncoder<0, 1> knob;
+FastEncoder<0, 1> twin;
+FastEncoder<2, 40> split;
+
+static const uint8_t forward[4] = {0, 2, 3, 1};
+
+static uint32_t rng = 1;
+static uint32_t random_u32(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static int32_t floor_div(int32_t a, int32_t b)
+{
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+// The count for the true position p (x4) from 0, see sampler.cpp.
+static int32_t expected(int32_t p)
+{
+	if (ENCODER_RESOLUTION == 2) return floor_div(p, 2);
+	if (ENCODER_RESOLUTION == 1) return floor_div(p - 2, 4) - floor_div(-2, 4);
+	return p;
+}
+
+int main(void)
+{
+	uint32_t errors = 0;
+	unsigned long changes1 = 0, changes2 = 0;
+	int32_t p = 0;
+	for (uint32_t n=0; n < NUM_STEPS; n++) {
+		p += (random_u32() & 1) ? 1 : -1;
+		uint8_t pins = forward[p & 3];
+		if (digitalRead(0) != (pins & 1)) changes1++;
+		if (digitalRead(1) != (pins >> 1)) changes2++;
+		host_pin_write(0, pins & 1);
+		host_pin_write(1, pins >> 1);
+		host_pin_write(2, pins & 1);
+		host_pin_write(40, pins >> 1);
+		int32_t a = knob.read(), b = twin.read(), c = split.read();
+		if ((a != expected(p) || b != expected(p) || c != expected(p)) && errors++ < 10) {
+			printf("step %u: read %d, %d, %d, expected %d\n", n, a, b, c, expected(p));
+		}
+	}
+	knob.write(1000);
+	if (knob.read() != 1000 || twin.read() != expected(p)) {
+		printf("write(): %d, %d, expected 1000, %d\n", knob.read(), twin.read(), expected(p));
+		errors++;
+	}
+#ifdef ENCODER_USE_INTERRUPTS
+	// knob has interrupts on pins 0 and 1 (only pin1 at x1 and x2),
+	// split only on pin 2, twin none
+	unsigned long knob_irqs = changes1 + ((ENCODER_RESOLUTION == 4) ? changes2 : 0);
+	if (isr_entries != knob_irqs + changes1 || isr_exits != isr_entries) {
+		printf("ENCODER_ISR_ENTRY/EXIT: %lu, %lu, expected %lu\n",
+			isr_entries, isr_exits, knob_irqs + changes1);
+		errors++;
+	}
+#ifdef ENCODER_ISR_INSTRUMENTATION
+	if (knob.isrStats().count != knob_irqs) {
+		printf("isrStats().count %lu, expected %lu\n",
+			(unsigned long)knob.isrStats().count, knob_irqs);
+		errors++;
+	}
+#endif
+#endif
+	printf("FastEncoder: %s\n", errors ? "FAIL" : "ok");
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,138 @@
+/* Encoder Library - host check of ENCODER_USE_PCINT on an ATmega328P
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ *
+ * Builds Encoder as if for an Uno with ENCODER_USE_PCINT, against the
+ * fake AVR in avr/, and wires 6 encoders like the PinChangeKnobs
+ * example: 1 on INT0 and INT1, 5 on pin change interrupts in all 3
+ * groups.  A 7th encoder finds its group full, and must say so with
+ * interruptsAttached(), and still count through read().  All follow
+ * random steps, and must always read the true count.  The pin change
+ * vectors must only run for their own group's pins.
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -DARDUINO=100 -Iavr -I../.. pcint.cpp -o pcint && ./pcint
+ *
+ * Also check with -DENCODER_RESOLUTION=2 and 1, with
+ * -DENCODER_OPTIMIZE_INTERRUPTS, and with -DENCODER_USE_TIMESTAMPS,
+ * where interpolatedRead() called with interrupts off (as from a
+ * control interrupt) must leave them off.
+ */
+
+#include <stdio.h>
+
+#define __AVR__
+#define __AVR_ATmega328P__
+// 2 per group, so the 7th encoder fills 1
+#define ENCODER_PCINT_MAX_PER_GROUP	2
+// the C update(), see avr/Arduino.h
+#define ENCODER_USE_STATS
+#define ENCODER_USE_PCINT
+#include "Encoder.h"
+
+#ifndef ENCODER_PCINT
+#error "pcint.h did not find the pin change interrupts"
+#endif
+
+// pin1, pin2.  The last has no room in its group.
+static const uint8_t wiring[][2] = {
+	{2, 3}, {4, 5}, {6, 7}, {8, 9}, {10, 11}, {A0, A1}, {12, 13},
+};
+#define NUM_ENCODERS	(sizeof(wiring) / sizeof(wiring[0]))
+#define NUM_STEPS	200000
+
+static const uint8_t forward[4] = {0, 2, 3, 1};
+
+static uint32_t rng = 1;
+static uint32_t random_u32(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static int32_t floor_div(int32_t a, int32_t b)
+{
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+// The count for the true position p (x4) from 0, see sampler.cpp.
+static int32_t expected(int32_t p)
+{
+	if (ENCODER_RESOLUTION == 2) return floor_div(p, 2);
+	if (ENCODER_RESOLUTION == 1) return floor_div(p - 2, 4) - floor_div(-2, 4);
+	return p;
+}
+
+static Encoder *enc[NUM_ENCODERS];
+static int32_t truth[NUM_ENCODERS];
+static uint32_t errors;
+
+static void check(bool ok, const char *what)
+{
+	if (!ok) {
+		printf("%s: FAIL\n", what);
+		errors++;
+	}
+}
+
+int main(void)
+{
+	for (uint8_t i=0; i < NUM_ENCODERS; i++) {
+		enc[i] = new Encoder(wiring[i][0], wiring[i][1]);
+		bool full = (i == NUM_ENCODERS - 1);
+		if (enc[i]->interruptsAttached() == full) {
+			printf("pins %d, %d: interruptsAttached() %d\n", wiring[i][0],
+				wiring[i][1], !full);
+			errors++;
+		}
+	}
+#ifdef ENCODER_OPTIMIZE_INTERRUPTS
+	check((EICRA & 3) == CHANGE, "EICRA mode for INT0");
+#endif
+	// only pin1 at x1 and x2
+	check(PCMSK2 == ((ENCODER_RESOLUTION == 4) ? 0xF0 : 0x50), "PCMSK2");
+	check(PCMSK0 == ((ENCODER_RESOLUTION == 4) ? 0x0F : 0x05), "PCMSK0");
+	check(PCMSK1 == ((ENCODER_RESOLUTION == 4) ? 0x03 : 0x01), "PCMSK1");
+
+	uint32_t changes[3] = {0, 0, 0};
+	for (uint32_t n=0; n < NUM_STEPS; n++) {
+		uint8_t i = random_u32() % NUM_ENCODERS;
+		truth[i] += (random_u32() & 1) ? 1 : -1;
+		uint8_t pins = forward[truth[i] & 3];
+		for (uint8_t p=0; p < 2; p++) {
+			uint8_t pin = wiring[i][p];
+			uint8_t level = (pins >> p) & 1;
+			if (digitalRead(pin) == level) continue;
+			bool enabled = (p == 0 || ENCODER_RESOLUTION == 4) && i > 0 &&
+				i < NUM_ENCODERS - 1;
+			if (enabled) changes[digitalPinToPCICRbit(pin)]++;
+			host_pin_write(pin, level);
+		}
+		for (uint8_t e=0; e < NUM_ENCODERS; e++) {
+			int32_t got = enc[e]->read();
+			if (got != expected(truth[e]) && errors++ < 10) {
+				printf("step %u: pins %d, %d: read %d, expected %d\n", n,
+					wiring[e][0], wiring[e][1], got, expected(truth[e]));
+			}
+		}
+	}
+	for (uint8_t g=0; g < 3; g++) {
+		if (host_pcint_calls[g] != changes[g]) {
+			printf("PCINT%u_vect ran %u times, expected %u\n", g,
+				host_pcint_calls[g], changes[g]);
+			errors++;
+		}
+	}
+#ifdef ENCODER_USE_TIMESTAMPS
+	cli();
+	enc[0]->interpolatedRead();
+	check(!(SREG & 0x80), "interpolatedRead() keeps interrupts off");
+	sei();
+#endif
+
+	printf("PCINT backend: %s\n", errors ? "FAIL" : "ok");
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,118 @@
+/* Encoder Library - host check of the ESP32 PCNT hardware counter
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ *
+ * Builds Encoder as if for ESP32 with ENCODER_USE_HARDWARE_COUNTER,
+ * against the fake PCNT driver in esp32/, which has 2 units.  2
+ * encoders get a unit, and the third must fall back to its pin
+ * interrupts.  All 3 follow the same random motion, over 100000 counts
+ * away from 0 and back, so the 16 bit units overflow both ways, and
+ * must always agree with the true count, through write() and
+ * readAndReset() too.
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -DARDUINO=100 -I. -Iesp32 -I../.. pcnt.cpp -o pcnt && ./pcnt
+ */
+
+#include <stdio.h>
+
+#define ESP32
+#define ESP_ARDUINO_VERSION_MAJOR	3
+#define ICACHE_RAM_ATTR
+#define DRAM_ATTR
+#define ENCODER_USE_HARDWARE_COUNTER
+#include "Encoder.h"
+
+#ifndef ENCODER_HARDWARE_COUNTER
+#error "hardware_counter.h did not pick the ESP32 PCNT backend"
+#endif
+
+// pin1, pin2.  The last has interrupts on the host.
+static const uint8_t wiring[][2] = {
+	{10, 11}, {21, 20}, {0, 1},
+};
+#define NUM_ENCODERS	(sizeof(wiring) / sizeof(wiring[0]))
+#define NUM_STEPS	400000
+
+static const uint8_t forward[4] = {0, 2, 3, 1};
+
+static uint32_t rng = 1;
+static uint32_t random_u32(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static Encoder *enc[NUM_ENCODERS];
+static int32_t truth[NUM_ENCODERS];
+static uint8_t phase;
+static uint32_t errors;
+
+static void step(int8_t dir)
+{
+	phase = (phase + dir) & 3;
+	for (uint8_t i=0; i < NUM_ENCODERS; i++) {
+		// pin order differs, but only 1 pin changes per step
+		host_pcnt_pin_write(wiring[i][0], forward[phase] & 1);
+		host_pcnt_pin_write(wiring[i][1], forward[phase] >> 1);
+		truth[i] += dir;
+	}
+}
+
+static void check(const char *what, uint32_t n)
+{
+	for (uint8_t i=0; i < NUM_ENCODERS; i++) {
+		int32_t got = enc[i]->read();
+		if (got != truth[i] && errors++ < 10) {
+			printf("%s, step %u: pins %d, %d: read %d, expected %d\n", what,
+				n, wiring[i][0], wiring[i][1], got, truth[i]);
+		}
+	}
+}
+
+int main(void)
+{
+	for (uint8_t i=0; i < NUM_ENCODERS; i++) {
+		enc[i] = new Encoder(wiring[i][0], wiring[i][1]);
+	}
+	uint8_t units = 0;
+	for (int i=0; i < HOST_PCNT_UNITS; i++) units += host_pcnt_unit[i].running;
+	if (units != 2 || !host_isr_arg[wiring[2][0]] || !host_isr_arg[wiring[2][1]]) {
+		printf("expected 2 units running and interrupts on pins %d, %d\n",
+			wiring[2][0], wiring[2][1]);
+		errors++;
+	}
+
+	// out past +2^16 and back past -2^16, with some back and forth
+	int8_t dir = 1;
+	for (uint32_t n=0; n < NUM_STEPS; n++) {
+		if (n == NUM_STEPS / 4) dir = -1;
+		if (n == NUM_STEPS * 3 / 4) dir = 1;
+		step((random_u32() & 7) ? dir : -dir);
+		if ((n & 255) == 0) check("moving", n);
+	}
+	check("end", NUM_STEPS);
+
+	for (uint8_t i=0; i < NUM_ENCODERS; i++) {
+		enc[i]->write(-1000 * i);
+		truth[i] = -1000 * i;
+	}
+	for (uint32_t n=0; n < 50000; n++) step(-1);
+	check("after write", 0);
+	for (uint8_t i=0; i < NUM_ENCODERS; i++) {
+		int32_t got = enc[i]->readAndReset();
+		if (got != truth[i] && errors++ < 10) {
+			printf("readAndReset: pins %d, %d: %d, expected %d\n",
+				wiring[i][0], wiring[i][1], got, truth[i]);
+		}
+		truth[i] = 0;
+	}
+	for (uint32_t n=0; n < 40000; n++) step(1);
+	check("after readAndReset", 0);
+
+	printf("PCNT backend: %s\n", errors ? "FAIL" : "ok");
+	return errors ? 1 : 0;
+}
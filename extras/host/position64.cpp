@@ -0,0 +1,170 @@
+/* Encoder Library - host check of ENCODER_USE_64BIT_POSITION
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ *
+ * Moves an encoder across the 32 bit wrap, forward and back, starting
+ * from positions set by write64() with various upper bits, and checks
+ * read64() after every step.  With -l, it also moves more than 2^31
+ * counts each way with only read() being called, and checks that
+ * read64() is still right.  That takes about a minute.
+ *
+ * With ENCODER_USE_INDEX, an index reset far from 0 must start the 64
+ * bit position again from the reset value, as write64() would, and
+ * with ENCODER_USE_TIMESTAMPS too, velocity() must not see the jump.
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -DARDUINO=100 -DENCODER_USE_64BIT_POSITION -I. -I../.. position64.cpp -o position64 && ./position64
+ *
+ * Also check with -DENCODER_DO_NOT_USE_INTERRUPTS, and with
+ * -DENCODER_USE_INDEX -DENCODER_USE_TIMESTAMPS.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef ENCODER_USE_TIMESTAMPS
+// 1 tick per step, so velocity() is known
+static uint32_t sim_time;
+#define ENCODER_TIMESTAMP()	sim_time
+#define ENCODER_TIMESTAMP_HZ	1000000
+#endif
+
+#include "Encoder.h"
+
+#ifndef ENCODER_USE_64BIT_POSITION
+#error "Compile with -DENCODER_USE_64BIT_POSITION"
+#endif
+#if ENCODER_RESOLUTION != 4
+#error "This check counts every edge, use ENCODER_RESOLUTION 4"
+#endif
+
+#define PIN1	0
+#define PIN2	1
+#define INDEX	2
+
+static const uint8_t forward[4] = {0, 2, 3, 1};
+static uint8_t phase;
+static uint32_t errors;
+
+static void step(Encoder &enc, int8_t dir)
+{
+#ifdef ENCODER_USE_TIMESTAMPS
+	sim_time += 100;
+#endif
+	phase = (phase + dir) & 3;
+#ifdef ENCODER_USE_INTERRUPTS
+	host_pin_write(PIN1, forward[phase] & 1);
+	host_pin_write(PIN2, forward[phase] >> 1);
+	(void)enc;
+#else
+	host_gpio[0] = (host_gpio[0] & ~3) | forward[phase];
+	enc.read();
+#endif
+}
+
+static void check(int64_t got, int64_t expect, const char *what)
+{
+	if (got != expect && errors++ < 10) {
+		printf("%s: read64 %lld, expected %lld\n", what,
+			(long long)got, (long long)expect);
+	}
+}
+
+// Start at p, move "steps" one way, then all the way back.
+static void cross(Encoder &enc, int64_t p, int32_t steps, const char *what)
+{
+	enc.write64(p);
+	check(enc.read64(), p, what);
+	int8_t dir = (steps > 0) ? 1 : -1;
+	for (int32_t i=1; i <= steps * dir; i++) {
+		step(enc, dir);
+		check(enc.read64(), p + i * dir, what);
+	}
+	for (int32_t i=steps * dir - 1; i >= 0; i--) {
+		step(enc, -dir);
+		check(enc.read64(), p + i * dir, what);
+	}
+}
+
+#ifdef ENCODER_USE_INDEX
+static void index_pulse(Encoder &enc)
+{
+	// without interrupts, read() must see the pin high
+	host_pin_write(INDEX, 1);
+#ifndef ENCODER_USE_INTERRUPTS
+	enc.read();
+#else
+	(void)enc;
+#endif
+	host_pin_write(INDEX, 0);
+}
+
+// Index resets, from 64 bit positions with upper bits, to 1000.
+static void index_reset(Encoder &enc, int64_t p, int8_t dir)
+{
+	enc.setIndexReset(true, 1000);
+	enc.write64(p);
+	for (int i=0; i < 100; i++) step(enc, dir);
+	check(enc.read64(), p + 100 * dir, "before index reset");
+#ifdef ENCODER_USE_TIMESTAMPS
+	enc.velocity();
+#endif
+	for (int i=0; i < 5; i++) {
+		index_pulse(enc);
+		for (int i=0; i < 50; i++) step(enc, dir);
+	}
+	check(enc.read64(), 1000 + 50 * dir, "after index reset");
+#ifdef ENCODER_USE_TIMESTAMPS
+	// 250 steps of 100 ticks each
+	float v = enc.velocity();
+	if ((v - 10000.0f * dir) > 1.0f || (v - 10000.0f * dir) < -1.0f) {
+		printf("velocity() after index reset: %f, expected %d\n", v, 10000 * dir);
+		errors++;
+	}
+#endif
+	enc.setIndexReset(false);
+	for (int i=0; i < 10; i++) step(enc, dir);
+	index_pulse(enc);
+	for (int i=0; i < 10; i++) step(enc, dir);
+	check(enc.read64(), 1000 + 70 * dir, "index without reset");
+}
+#endif
+
+int main(int argc, char **argv)
+{
+	const int64_t wrap = (int64_t)1 << 31;
+	const int64_t high = (int64_t)5 << 32;
+#ifdef ENCODER_USE_INDEX
+	Encoder enc(PIN1, PIN2, INDEX);
+	index_reset(enc, high + wrap - 50, 1);
+	index_reset(enc, -high - wrap + 50, -1);
+#else
+	Encoder enc(PIN1, PIN2);
+#endif
+
+	cross(enc, wrap - 100, 200, "up across +2^31");
+	cross(enc, -wrap + 100, -200, "down across -2^31");
+	cross(enc, high + wrap - 100, 200, "up across 5 * 2^32 + 2^31");
+	cross(enc, -high - wrap + 100, -200, "down across -5 * 2^32 - 2^31");
+	cross(enc, high - 100, 200, "up across 5 * 2^32");
+	cross(enc, -high + 100, -200, "down across -5 * 2^32");
+
+	if (argc > 1 && strcmp(argv[1], "-l") == 0) {
+		// more than 2^31 counts between read64() calls, with read()
+		// called every 2^16 counts
+		const int64_t n = wrap + 12345;
+		for (int dir=1; dir >= -1; dir -= 2) {
+			enc.write64(0);
+			for (int64_t i=1; i <= n; i++) {
+				step(enc, dir);
+				if ((i & 0xFFFF) == 0) enc.read();
+			}
+			check(enc.read64(), n * dir, dir > 0 ? "2^31 forward" : "2^31 back");
+		}
+	}
+
+	printf("64 bit position: %s\n", errors ? "FAIL" : "ok");
+	return errors ? 1 : 0;
+}
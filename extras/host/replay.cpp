@@ -0,0 +1,478 @@
+/* Encoder Library - replay a logic analyzer capture through update()
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ *
+ * When a real encoder miscounts, capture its pins with a logic analyzer,
+ * export from sigrok / PulseView as CSV or VCD, and replay the capture
+ * through update() on a PC, as if every sample were read by the board.
+ * Prints the final position, every double step (both pins changed
+ * between 2 samples, so update() had to guess the direction), the
+ * fastest edge rate, and optionally the position over time.
+ *
+ * The file is memory mapped and parsed in 1 pass, so captures of
+ * hundreds of millions of samples replay in seconds.
+ *
+ * Build from this directory:
+ *   g++ -O2 -DARDUINO=100 -I. -I../.. replay.cpp -o replay
+ *
+ *   ./replay capture.csv                pins are the first 2 channels
+ *   ./replay -a D2 -b D3 capture.vcd    choose channels by name
+ *   ./replay -i 0.01 capture.csv        also print position every 10 ms
+ *   ./replay -r 24000000 capture.csv    sample rate, if not in the file
+ *   ./replay -w 0.0001 capture.csv      busiest window, default 1 ms
+ *   ./replay -d 100 capture.csv         print up to 100 double steps
+ *
+ * CSV: lines starting with ';' are comments ("; Samplerate: 24 MHz" is
+ * used), then an optional line of channel names, then 1 line per
+ * sample.  A "Time" column, in seconds, is used if present.  VCD: each
+ * timestamp with a change on A or B is 1 sample.
+ *
+ * Add any Encoder option on the command line, for example
+ * -DENCODER_RESOLUTION=2, to replay with that configuration.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Encoder.h"
+
+#define MAX_COLUMNS		64
+#define MAX_NAME		32
+
+typedef struct {
+	const char *a_name, *b_name;	// channel names, or NULL for the first 2
+	double   rate;			// samples per second, 0 if unknown
+	double   interval;		// print the position this often, 0 for never
+	double   window;		// for the busiest window, in time units
+	uint32_t max_doubles;		// double steps to print
+} options_t;
+
+typedef struct {
+	Encoder_internal_state_t enc;
+	uint8_t  pins;			// pin1 is bit 0, pin2 bit 1
+	uint64_t samples, edges, doubles;
+	double   last_edge, shortest, shortest_at;
+	double   window_start;
+	uint32_t window_edges, busiest;
+	double   busiest_at;
+	double   next_print;
+	const char *unit;		// "s", or "samples" without a rate
+} replay_t;
+
+static options_t opt;
+static replay_t rp;
+
+static double now_s(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void replay_begin(const char *unit)
+{
+	memset(&rp.enc, 0, sizeof(rp.enc));
+	rp.enc.pin1_register = PIN_TO_BASEREG(0);
+	rp.enc.pin2_register = PIN_TO_BASEREG(1);
+	rp.enc.pin1_bitmask = PIN_TO_BITMASK(0);
+	rp.enc.pin2_bitmask = PIN_TO_BITMASK(1);
+	rp.pins = 0xFF;		// the first sample sets the state
+	rp.last_edge = -1;
+	rp.shortest = -1;
+	rp.window_start = 0;
+	rp.unit = unit;
+	if (opt.window == 0) {
+		// 1 ms, or 1000 samples when the time is unknown
+		opt.window = strcmp(unit, "s") ? 1000 : 1e-3;
+	}
+}
+
+// Print the position at every interval boundary up to time t.
+static void print_timeline(double t)
+{
+	while (t >= rp.next_print) {
+		printf("%14.9f %s  position %ld\n", rp.next_print, rp.unit,
+			(long)rp.enc.position);
+		rp.next_print += opt.interval;
+	}
+}
+
+// One sample of both pins, at time t.
+static inline void replay_sample(double t, uint8_t pins)
+{
+	rp.samples++;
+	if (pins == rp.pins) return;
+	host_gpio[0] = pins;
+	if (rp.pins == 0xFF) {
+		// first sample, nothing moved yet
+		rp.enc.state = pins;
+		rp.pins = pins;
+		rp.window_start = t;
+		rp.next_print = t;
+		return;
+	}
+	if (opt.interval > 0) print_timeline(t);
+	uint8_t changed = pins ^ rp.pins;
+	rp.pins = pins;
+	int32_t before = rp.enc.position;
+	update(&rp.enc);
+	rp.edges += (changed == 3) ? 2 : 1;
+	if (changed == 3) {
+		if (rp.doubles < opt.max_doubles) {
+			printf("double step at %.9f %s: position %ld -> %ld\n", t,
+				rp.unit, (long)before, (long)rp.enc.position);
+		}
+		rp.doubles++;
+	}
+	if (rp.last_edge >= 0) {
+		double gap = t - rp.last_edge;
+		if (gap > 0 && (rp.shortest < 0 || gap < rp.shortest)) {
+			rp.shortest = gap;
+			rp.shortest_at = t;
+		}
+	}
+	rp.last_edge = t;
+	if (t - rp.window_start >= opt.window) {
+		rp.window_start = t;
+		rp.window_edges = 0;
+	}
+	rp.window_edges += (changed == 3) ? 2 : 1;
+	if (rp.window_edges > rp.busiest) {
+		rp.busiest = rp.window_edges;
+		rp.busiest_at = rp.window_start;
+	}
+}
+
+static void replay_end(double t, double seconds)
+{
+	if (opt.interval > 0) print_timeline(t);
+	printf("%llu samples, %llu edges, %llu double steps, final position %ld\n",
+		(unsigned long long)rp.samples, (unsigned long long)rp.edges,
+		(unsigned long long)rp.doubles, (long)rp.enc.position);
+	if (rp.shortest > 0) {
+		printf("shortest edge gap %.9g %s at %.9f (%.6g edges/%s)\n",
+			rp.shortest, rp.unit, rp.shortest_at, 1.0 / rp.shortest, rp.unit);
+	}
+	printf("busiest %.6g %s window: %u edges at %.9f (%.6g edges/%s)\n",
+		opt.window, rp.unit, rp.busiest, rp.busiest_at,
+		rp.busiest / opt.window, rp.unit);
+	printf("replayed in %.3f s, %.1f Msamples/s\n", seconds,
+		rp.samples / seconds * 1e-6);
+}
+
+// Parse a decimal number, with optional fraction and exponent, quickly.
+static const char * parse_number(const char *p, const char *end, double *out)
+{
+	double v = 0, scale = 1;
+	bool neg = false;
+	if (p < end && (*p == '-' || *p == '+')) neg = (*p++ == '-');
+	while (p < end && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+	if (p < end && *p == '.') {
+		p++;
+		while (p < end && *p >= '0' && *p <= '9') {
+			scale *= 0.1;
+			v += (*p++ - '0') * scale;
+		}
+	}
+	if (p < end && (*p == 'e' || *p == 'E')) {
+		char buf[8];
+		int n = 0;
+		p++;
+		while (p < end && n < 7 && (isdigit((unsigned char)*p) || *p == '-' || *p == '+')) {
+			buf[n++] = *p++;
+		}
+		buf[n] = 0;
+		for (int e = atoi(buf); e > 0; e--) v *= 10;
+		for (int e = atoi(buf); e < 0; e++) v *= 0.1;
+	}
+	*out = neg ? -v : v;
+	return p;
+}
+
+static const char * line_end(const char *p, const char *end)
+{
+	const char *nl = (const char *)memchr(p, '\n', end - p);
+	return nl ? nl : end;
+}
+
+// "; Samplerate: 24 MHz"
+static void csv_comment(const char *p, const char *eol)
+{
+	const char *key = "Samplerate:";
+	size_t len = strlen(key);
+	while (p < eol && (*p == ';' || *p == ' ')) p++;
+	if ((size_t)(eol - p) <= len || strncasecmp(p, key, len)) return;
+	p += len;
+	while (p < eol && *p == ' ') p++;
+	double rate;
+	p = parse_number(p, eol, &rate);
+	while (p < eol && *p == ' ') p++;
+	if (p < eol && (*p == 'k' || *p == 'K')) rate *= 1e3;
+	if (p < eol && *p == 'M') rate *= 1e6;
+	if (p < eol && *p == 'G') rate *= 1e9;
+	if (opt.rate == 0) opt.rate = rate;
+}
+
+static int find_column(char names[][MAX_NAME], int num, const char *name, int skip1, int skip2)
+{
+	for (int i=0; i < num; i++) {
+		if (name ? !strcmp(names[i], name) : (i != skip1 && i != skip2)) return i;
+	}
+	return -1;
+}
+
+static bool replay_csv(const char *p, const char *end)
+{
+	char names[MAX_COLUMNS][MAX_NAME];
+	int num = 0, col_time = -1, col_a, col_b;
+
+	while (p < end && (*p == ';' || *p == '#' || *p == '\r' || *p == '\n')) {
+		const char *eol = line_end(p, end);
+		csv_comment(p, eol);
+		p = eol + 1;
+	}
+	if (p >= end) return false;
+	if (!isdigit((unsigned char)*p) && *p != '-' && *p != '.') {
+		// a line of channel names
+		const char *eol = line_end(p, end);
+		while (p < eol && num < MAX_COLUMNS) {
+			const char *f = p;
+			while (p < eol && *p != ',' && *p != '\r') p++;
+			size_t len = p - f;
+			if (len >= MAX_NAME) len = MAX_NAME - 1;
+			memcpy(names[num], f, len);
+			names[num][len] = 0;
+			if (!strcasecmp(names[num], "Time")) col_time = num;
+			num++;
+			if (p < eol && *p == ',') p++; else break;
+		}
+		p = eol + 1;
+	} else {
+		const char *eol = line_end(p, end);
+		for (const char *q = p; q < eol; q++) {
+			if (*q == ',') num++;
+		}
+		num++;
+		for (int i=0; i < num && i < MAX_COLUMNS; i++) snprintf(names[i], MAX_NAME, "%d", i);
+	}
+	col_a = find_column(names, num, opt.a_name, col_time, -1);
+	col_b = find_column(names, num, opt.b_name, col_time, col_a);
+	if (col_a < 0 || col_b < 0) {
+		printf("channels not found\n");
+		return false;
+	}
+	printf("A = %s, B = %s%s\n", names[col_a], names[col_b],
+		col_time >= 0 ? ", using the Time column" : "");
+
+	double scale = (opt.rate > 0) ? 1.0 / opt.rate : 1.0;
+	replay_begin((col_time >= 0 || opt.rate > 0) ? "s" : "samples");
+	double t = 0, begin = now_s();
+	uint64_t n = 0;
+	while (p < end) {
+		uint8_t pins = 0;
+		int col = 0;
+		if (*p == '\n' || *p == '\r' || *p == ';') {
+			p = line_end(p, end) + 1;
+			continue;
+		}
+		t = n * scale;
+		while (p < end && *p != '\n') {
+			if (col == col_time) {
+				p = parse_number(p, end, &t);
+			} else {
+				while (p < end && *p == ' ') p++;
+				if (p < end && *p != '0' && *p != ',' && *p != '\n') {
+					if (col == col_a) pins |= 1;
+					if (col == col_b) pins |= 2;
+				}
+			}
+			while (p < end && *p != ',' && *p != '\n') p++;
+			if (p < end && *p == ',') {
+				p++;
+				col++;
+			}
+		}
+		p++;
+		replay_sample(t, pins);
+		n++;
+	}
+	replay_end(t, now_s() - begin);
+	return true;
+}
+
+typedef struct {
+	char    id[MAX_NAME];
+	char    name[MAX_NAME];
+} vcd_var_t;
+
+static const char * vcd_token(const char *p, const char *end, const char **tok, size_t *len)
+{
+	while (p < end && isspace((unsigned char)*p)) p++;
+	*tok = p;
+	while (p < end && !isspace((unsigned char)*p)) p++;
+	*len = p - *tok;
+	return p;
+}
+
+static bool token_is(const char *tok, size_t len, const char *s)
+{
+	return len == strlen(s) && !memcmp(tok, s, len);
+}
+
+static bool replay_vcd(const char *p, const char *end)
+{
+	vcd_var_t vars[MAX_COLUMNS];
+	int num = 0;
+	double timescale = 1;
+	const char *tok;
+	size_t len;
+
+	// header: $var wire 1 <id> <name> $end ... $enddefinitions $end
+	while (p < end) {
+		p = vcd_token(p, end, &tok, &len);
+		if (len == 0) return false;
+		if (token_is(tok, len, "$enddefinitions")) {
+			while (p < end && !token_is(tok, len, "$end")) p = vcd_token(p, end, &tok, &len);
+			break;
+		} else if (token_is(tok, len, "$var")) {
+			const char *f[5];
+			size_t fl[5];
+			int n = 0;
+			while (p < end) {
+				p = vcd_token(p, end, &tok, &len);
+				if (token_is(tok, len, "$end") || len == 0) break;
+				if (n < 5) { f[n] = tok; fl[n] = len; n++; }
+			}
+			// type, width, id, name
+			if (n >= 4 && num < MAX_COLUMNS && token_is(f[1], fl[1], "1")) {
+				snprintf(vars[num].id, MAX_NAME, "%.*s", (int)fl[2], f[2]);
+				snprintf(vars[num].name, MAX_NAME, "%.*s", (int)fl[3], f[3]);
+				num++;
+			}
+		} else if (token_is(tok, len, "$timescale")) {
+			char buf[MAX_NAME] = "";
+			while (p < end) {
+				p = vcd_token(p, end, &tok, &len);
+				if (token_is(tok, len, "$end") || len == 0) break;
+				strncat(buf, tok, (len < MAX_NAME - 1 - strlen(buf)) ? len : MAX_NAME - 1 - strlen(buf));
+			}
+			const char *u = parse_number(buf, buf + strlen(buf), &timescale);
+			if (timescale == 0) timescale = 1;
+			if (!strcmp(u, "ms")) timescale *= 1e-3;
+			if (!strcmp(u, "us")) timescale *= 1e-6;
+			if (!strcmp(u, "ns")) timescale *= 1e-9;
+			if (!strcmp(u, "ps")) timescale *= 1e-12;
+			if (!strcmp(u, "fs")) timescale *= 1e-15;
+		} else if (tok[0] == '$' && !token_is(tok, len, "$end")) {
+			// $date, $version, $comment, $scope...: skip to $end
+			while (p < end && !token_is(tok, len, "$end")) p = vcd_token(p, end, &tok, &len);
+		}
+	}
+	char names[MAX_COLUMNS][MAX_NAME];
+	for (int i=0; i < num; i++) strcpy(names[i], vars[i].name);
+	int a = find_column(names, num, opt.a_name, -1, -1);
+	int b = find_column(names, num, opt.b_name, a, -1);
+	if (a < 0 || b < 0) {
+		printf("channels not found\n");
+		return false;
+	}
+	printf("A = %s, B = %s, timescale %g s\n", vars[a].name, vars[b].name, timescale);
+	size_t a_len = strlen(vars[a].id), b_len = strlen(vars[b].id);
+
+	replay_begin("s");
+	double begin = now_s();
+	double t = 0;
+	bool timed = false;
+	uint8_t pins = 0, sampled = 0xFF;
+	while (p < end) {
+		p = vcd_token(p, end, &tok, &len);
+		if (len == 0) break;
+		if (tok[0] == '#') {
+			// a new time: the changes so far are 1 sample
+			if (timed && pins != sampled) {
+				replay_sample(t, pins);
+				sampled = pins;
+			}
+			double ticks;
+			parse_number(tok + 1, tok + len, &ticks);
+			t = ticks * timescale;
+			timed = true;
+			continue;
+		}
+		const char *id;
+		size_t id_len;
+		char v;
+		if (tok[0] == 'b' || tok[0] == 'B') {
+			v = tok[len - 1];
+			p = vcd_token(p, end, &id, &id_len);
+		} else if (tok[0] == '$') {
+			continue;	// $dumpvars, $end...
+		} else {
+			v = tok[0];
+			id = tok + 1;
+			id_len = len - 1;
+		}
+		uint8_t bit;
+		if (id_len == a_len && !memcmp(id, vars[a].id, a_len)) bit = 1;
+		else if (id_len == b_len && !memcmp(id, vars[b].id, b_len)) bit = 2;
+		else continue;
+		if (v == '1') pins |= bit; else pins &= ~bit;
+	}
+	if (pins != sampled) replay_sample(t, pins);
+	replay_end(t, now_s() - begin);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	const char *file = NULL;
+	opt.max_doubles = 20;
+	bool usage = false;
+	for (int i=1; i < argc; i++) {
+		if (!strcmp(argv[i], "-a") && i + 1 < argc) opt.a_name = argv[++i];
+		else if (!strcmp(argv[i], "-b") && i + 1 < argc) opt.b_name = argv[++i];
+		else if (!strcmp(argv[i], "-r") && i + 1 < argc) opt.rate = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-i") && i + 1 < argc) opt.interval = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-w") && i + 1 < argc) opt.window = atof(argv[++i]);
+		else if (!strcmp(argv[i], "-d") && i + 1 < argc) opt.max_doubles = atoi(argv[++i]);
+		else if (argv[i][0] != '-' && !file) file = argv[i];
+		else usage = true;
+	}
+	if (!file || usage) {
+		printf("usage: %s [-a chan] [-b chan] [-r rate] [-i interval] "
+			"[-w window] [-d doubles] capture.csv|capture.vcd\n", argv[0]);
+		return 2;
+	}
+	int fd = open(file, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0) {
+		perror(file);
+		return 1;
+	}
+	const char *data = (const char *)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	madvise((void *)data, st.st_size, MADV_SEQUENTIAL);
+
+	const char *dot = strrchr(file, '.');
+	bool vcd = dot && !strcasecmp(dot, ".vcd");
+	bool ok;
+	if (vcd) {
+		ok = replay_vcd(data, data + st.st_size);
+	} else {
+		ok = replay_csv(data, data + st.st_size);
+	}
+	munmap((void *)data, st.st_size);
+	close(fd);
+	return ok ? 0 : 1;
+}
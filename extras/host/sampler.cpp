@@ -0,0 +1,195 @@
+/* Encoder Library - host check of EncoderSampler
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ *
+ * Starts an EncoderSampler on the host's fake timer, and checks that a
+ * second sampler can't be started.  Then moves the encoders at up to 1
+ * step per timer tick, with slow, fast and random stretches, and checks
+ * every read() against the true count after each tick.
+ *
+ * With ENCODER_DO_NOT_USE_INTERRUPTS, every encoder is sampled.
+ * Without it, 2 encoders on interrupt pins are added in adaptive mode,
+ * and must switch to sampling while fast (their interrupts detached),
+ * back to interrupts while slow, and also while faster than 1 step per
+ * 2 ticks, where sampling would be below the Nyquist rate.  Then they
+ * switch back and forth while moving backward.  1 encoder
+ * without interrupt pins is always sampled.
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -DARDUINO=100 -I. -I../.. sampler.cpp -o sampler && ./sampler
+ *   g++ -O2 -DARDUINO=100 -DENCODER_DO_NOT_USE_INTERRUPTS -I. -I../.. sampler.cpp -o sampler && ./sampler
+ *
+ * Add -DENCODER_RESOLUTION=2 or 1 to check x2 or x1 decoding.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "EncoderSampler.h"
+
+#define RATE		10000
+#define RANDOM_TICKS	200000
+
+// pin1, pin2.  The first 2 have interrupts on the host.
+static const uint8_t wiring[][2] = {
+	{0, 1}, {2, 3}, {20, 21},
+};
+#define NUM_ENCODERS	(sizeof(wiring) / sizeof(wiring[0]))
+#define NUM_ADAPTIVE	2
+
+static const uint8_t forward[4] = {0, 2, 3, 1};
+
+static uint32_t rng = 1;
+static uint32_t random_u32(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static Encoder *enc[NUM_ENCODERS];
+static int32_t phase[NUM_ENCODERS];	// true position at x4
+static int32_t start[NUM_ENCODERS];
+static uint32_t errors;
+static uint32_t ticks;
+
+#if ENCODER_RESOLUTION < 4
+static int32_t floor_div(int32_t a, int32_t b)
+{
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+#endif
+
+// The count for the true position: every edge at x4, both pin1 edges
+// (phase 2 and 0) at x2, pin1 edges while pin2 is high (phase 2) at x1.
+static int32_t expected(uint8_t i)
+{
+#if ENCODER_RESOLUTION == 4
+	return phase[i] - start[i];
+#elif ENCODER_RESOLUTION == 2
+	return floor_div(phase[i], 2) - floor_div(start[i], 2);
+#else
+	return floor_div(phase[i] - 2, 4) - floor_div(start[i] - 2, 4);
+#endif
+}
+
+static void step(uint8_t i, int8_t dir)
+{
+	phase[i] += dir;
+	uint8_t pins = forward[phase[i] & 3];
+	host_pin_write(wiring[i][0], pins & 1);
+	host_pin_write(wiring[i][1], pins >> 1);
+}
+
+static void tick(const char *what, uint32_t n)
+{
+	host_timer_tick();
+	ticks++;
+	for (uint8_t i=0; i < NUM_ENCODERS; i++) {
+		int32_t got = enc[i]->read();
+		if (got != expected(i) && errors++ < 10) {
+			printf("%s, tick %u: pins %d, %d: read %d, expected %d\n", what,
+				n, wiring[i][0], wiring[i][1], got, expected(i));
+		}
+	}
+}
+
+// Every encoder moves 1 step in dir every "every" ticks.
+static void run(const char *what, uint32_t count, uint32_t every, int8_t dir = 1)
+{
+	for (uint32_t n=0; n < count; n++) {
+		if (n % every == 0) {
+			for (uint8_t i=0; i < NUM_ENCODERS; i++) step(i, dir);
+		}
+		tick(what, n);
+	}
+}
+
+static void check(bool ok, const char *what)
+{
+	if (!ok) {
+		printf("%s: FAIL\n", what);
+		errors++;
+	}
+}
+
+#ifdef ENCODER_USE_INTERRUPTS
+static bool attached(uint8_t pin)
+{
+	return host_isr[pin] || host_isr_arg[pin];
+}
+#endif
+
+int main(int argc, char **argv)
+{
+	if (argc > 1) rng = strtoul(argv[1], NULL, 0);
+	static EncoderSampler sampler, second;
+
+	for (uint8_t i=0; i < NUM_ENCODERS; i++) {
+		phase[i] = start[i] = random_u32() & 3;
+		host_pin_write(wiring[i][0], forward[phase[i]] & 1);
+		host_pin_write(wiring[i][1], forward[phase[i]] >> 1);
+		enc[i] = new Encoder(wiring[i][0], wiring[i][1]);
+#ifdef ENCODER_USE_INTERRUPTS
+		if (i < NUM_ADAPTIVE) {
+			check(sampler.add(*enc[i], wiring[i][0], wiring[i][1]), "add adaptive");
+			continue;
+		}
+#endif
+		check(sampler.add(*enc[i]), "add");
+	}
+	check(sampler.begin(RATE), "begin");
+	check(sampler.begin(RATE), "begin again");
+	check(!second.begin(RATE), "second sampler rejected");
+
+	run("slow", 20 * ENCODER_SAMPLER_WINDOW, 20);
+#ifdef ENCODER_USE_INTERRUPTS
+	check(sampler.switchCount() == 0, "slow stays on interrupts");
+	check(attached(wiring[0][0]), "slow keeps interrupt attached");
+	run("fast", 4 * ENCODER_SAMPLER_WINDOW, 3);
+	check(sampler.switchCount() == NUM_ADAPTIVE, "fast switches to sampling");
+	check(!attached(wiring[0][0]) && !attached(wiring[1][0]), "fast detaches interrupts");
+	run("too fast", 4 * ENCODER_SAMPLER_WINDOW, 1);
+	check(sampler.switchCount() == 2 * NUM_ADAPTIVE, "too fast switches back");
+	check(attached(wiring[0][0]) && attached(wiring[1][0]), "too fast attaches interrupts");
+	// the peak edge rate must decay before sampling takes over again
+	run("fast again", ENCODER_SAMPLER_WINDOW, 3);
+	check(sampler.switchCount() == 2 * NUM_ADAPTIVE, "fast right after a burst stays on interrupts");
+	run("fast again", 16 * ENCODER_SAMPLER_WINDOW, 3);
+	check(sampler.switchCount() == 3 * NUM_ADAPTIVE, "fast switches to sampling again");
+	run("slow again", 4 * ENCODER_SAMPLER_WINDOW, 20);
+	check(sampler.switchCount() == 4 * NUM_ADAPTIVE, "slow switches back");
+	check(attached(wiring[0][0]) && attached(wiring[1][0]), "slow attaches interrupts");
+	// switches land anywhere in a cycle, going backward too
+	for (uint8_t n=0; n < 4; n++) {
+		run("backward fast", 8 * ENCODER_SAMPLER_WINDOW, 3, -1);
+		run("backward slow", 4 * ENCODER_SAMPLER_WINDOW, 20, -1);
+	}
+	check(sampler.switchCount() == 12 * NUM_ADAPTIVE, "backward switches");
+#else
+	run("fast", 4 * ENCODER_SAMPLER_WINDOW, 1);
+#endif
+
+	// random speed and direction, at most 1 step per tick
+	uint32_t every = 1;
+	int8_t dir = 1;
+	for (uint32_t n=0; n < RANDOM_TICKS; n++) {
+		uint32_t r = random_u32();
+		if ((r & 1023) == 0) every = 1 + ((r >> 10) & 31);
+		if ((r & 255) == 1) dir = -dir;
+		if (n % every == 0) {
+			for (uint8_t i=0; i < NUM_ENCODERS; i++) {
+				// some back and forth on top
+				step(i, (random_u32() & 7) ? dir : -dir);
+			}
+		}
+		tick("random", n);
+	}
+
+	check(sampler.sampleCount() == ticks, "sampleCount");
+	printf("%u samples, %u switches: %s\n", (unsigned)sampler.sampleCount(),
+		(unsigned)sampler.switchCount(), errors ? "FAIL" : "ok");
+	return errors ? 1 : 0;
+}
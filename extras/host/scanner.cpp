@@ -0,0 +1,113 @@
+/* Encoder Library - host check of EncoderScanner
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ *
+ * Wires many encoders to the fake ports: some sharing a scanner group,
+ * some with a different pin distance or reversed pins (more groups),
+ * some with pins on 2 ports, and more than ENCODER_SCANNER_MAX_GROUPS
+ * combinations, so the rest fall back to update().  Every encoder also
+ * has a twin on the same pins which is not added to the scanner, so
+ * its read() uses the normal update().  The pins move at random, up to
+ * 2 steps between scans, and after every scan() each scanned count
+ * must equal its twin's.  With ENCODER_USE_STATS, which needs update()
+ * for every encoder, their stats() must be equal too.
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -DARDUINO=100 -DENCODER_DO_NOT_USE_INTERRUPTS -I. -I../.. scanner.cpp -o scanner && ./scanner
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define ENCODER_SCANNER_MAX_OTHERS	16
+#include "EncoderScanner.h"
+
+#define NUM_SCANS	200000
+
+// pin1, pin2
+static const uint8_t wiring[][2] = {
+	{0, 1}, {2, 3}, {4, 5}, {30, 31},	// port 0, 1 apart: 1 group
+	{6, 8}, {10, 12},			// port 0, 2 apart
+	{15, 14}, {17, 16},			// port 0, reversed
+	{33, 32}, {35, 34},			// port 1, reversed
+	{40, 43},				// port 1, 3 apart: no group left
+	{31 + 64, 32 + 64},			// port 2 and 3: not scannable
+	{20, 50},				// port 0 and 1: not scannable
+};
+#define NUM_ENCODERS	(sizeof(wiring) / sizeof(wiring[0]))
+
+static const uint8_t forward[4] = {0, 2, 3, 1};
+
+static uint32_t rng = 1;
+static uint32_t random_u32(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+
+static void pin_write(uint8_t pin, uint8_t val)
+{
+	volatile uint32_t *reg = portInputRegister(digitalPinToPort(pin));
+	if (val) *reg |= digitalPinToBitMask(pin);
+	else *reg &= ~digitalPinToBitMask(pin);
+}
+
+int main(int argc, char **argv)
+{
+	if (argc > 1) rng = strtoul(argv[1], NULL, 0);
+	Encoder *scanned[NUM_ENCODERS], *twin[NUM_ENCODERS];
+	uint8_t phase[NUM_ENCODERS];
+	EncoderScanner scanner;
+
+	for (unsigned i=0; i < NUM_ENCODERS; i++) {
+		phase[i] = random_u32() & 3;
+		pin_write(wiring[i][0], forward[phase[i]] & 1);
+		pin_write(wiring[i][1], forward[phase[i]] >> 1);
+		scanned[i] = new Encoder(wiring[i][0], wiring[i][1]);
+		twin[i] = new Encoder(wiring[i][0], wiring[i][1]);
+		if (!scanner.add(*scanned[i])) {
+			printf("add() failed for pins %d, %d\n", wiring[i][0], wiring[i][1]);
+			return 1;
+		}
+	}
+
+	uint32_t errors = 0;
+	for (uint32_t n=0; n < NUM_SCANS; n++) {
+		for (unsigned i=0; i < NUM_ENCODERS; i++) {
+			// mostly single steps, sometimes 2 (which both decoders
+			// must guess the same way), sometimes nothing
+			uint32_t r = random_u32() & 15;
+			int8_t steps = (r < 5) ? 1 : (r < 10) ? -1 : (r == 10) ? 2 : 0;
+			phase[i] = (phase[i] + steps) & 3;
+			pin_write(wiring[i][0], forward[phase[i]] & 1);
+			pin_write(wiring[i][1], forward[phase[i]] >> 1);
+		}
+		scanner.scan();
+		for (unsigned i=0; i < NUM_ENCODERS; i++) {
+			int32_t expect = twin[i]->read();
+			int32_t got = scanned[i]->read();
+			if (got != expect && errors++ < 10) {
+				printf("scan %u: pins %d, %d: scanner %d, update() %d\n",
+					n, wiring[i][0], wiring[i][1], got, expect);
+			}
+		}
+	}
+#ifdef ENCODER_USE_STATS
+	for (unsigned i=0; i < NUM_ENCODERS; i++) {
+		Encoder_stats_t a = scanned[i]->stats(), b = twin[i]->stats();
+		if (a.double_steps != b.double_steps || a.no_moves != b.no_moves) {
+			printf("pins %d, %d: stats %u, %u, update() %u, %u\n",
+				wiring[i][0], wiring[i][1], (unsigned)a.double_steps,
+				(unsigned)a.no_moves, (unsigned)b.double_steps,
+				(unsigned)b.no_moves);
+			errors++;
+		}
+	}
+#endif
+	printf("%u encoders, %u scans: %s\n", (unsigned)NUM_ENCODERS, NUM_SCANS,
+		errors ? "FAIL" : "ok");
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,639 @@
+/* Encoder Library - host quadrature simulator and decoder fuzzer
+ * http://www.pjrc.com/teensy/td_libs_Encoder.html
+ *
+ * This example code is in the public domain.
+ *
+ * Generates quadrature pin signals from speed profiles (constant, ramp,
+ * sine, random walk) with jitter, contact bounce, direction reversals
+ * and missed samples, and feeds them to the decoder: update() at a
+ * fixed sample rate, or a real Encoder through its pin interrupts.
+ * Every result is checked against a separate reference model of what
+ * the decoder should count, and against the true position.
+ *
+ * Whenever the decoder sees more than 1 step between two updates, some
+ * edges are missed, and the reference model decides whether the count
+ * is still right.  Each interval between updates is classified as:
+ *
+ *   exact      every edge seen, no information lost
+ *   cancelled  edges came and went between updates (bounce, jitter),
+ *              which costs nothing
+ *   double     2 steps, both pins changed, and the decoder's guess
+ *              (pin1 edges only) happened to be right
+ *   reversed   the decoder counted the wrong direction
+ *   lost       the decoder counted too few steps
+ *
+ * The run fails if the decoder ever differs from the reference model,
+ * if the count is wrong when every interval was within 1 step, or (with ENCODER_USE_STATS) if double_steps
+ * or no_moves are wrong.
+ *
+ * With ENCODER_GLITCH_FILTER, edges in the scenarios are spaced so the
+ * filter passes all of them, and a separate timed check adds contact
+ * bounce and noise spikes shorter than the filter, which it must
+ * reject without losing the count.  With ENCODER_ISR_INSTRUMENTATION
+ * too, isrStats() must count the rejected interrupts.
+ *
+ * Build and run from this directory:
+ *   g++ -O2 -DARDUINO=100 -I. -I../.. simulate.cpp -o simulate && ./simulate
+ *
+ *   ./simulate            the fixed scenarios, then 1000 random ones
+ *   ./simulate -n 100000  more random runs
+ *   ./simulate -s SEED    repeat 1 random run (printed on failure)
+ *   ./simulate -t         decoder throughput for each scenario
+ *
+ * Add any Encoder option on the command line, for example
+ * -DENCODER_RESOLUTION=2, to check that configuration.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#ifdef ENCODER_GLITCH_FILTER
+// The filter times interrupts with ENCODER_TIMESTAMP(), so give it a
+// clock which only moves when the simulation says.
+static uint32_t sim_time;
+#define ENCODER_TIMESTAMP()	sim_time
+#define ENCODER_TIMESTAMP_HZ	1000000
+#endif
+
+#include "Encoder.h"
+
+// update() is fed pins 8 and 9, which have no interrupts.  The Encoder
+// for interrupt scenarios uses pins 0 and 1.
+#define SAMPLED_PIN1	8
+#define SAMPLED_PIN2	9
+#define IRQ_PIN1	0
+#define IRQ_PIN2	1
+
+#define NUM_RUNS	5	// throughput is the best of this many
+
+// Stepping through this table moves the position +1 per step.
+// Pin1 is bit 0 and pin2 is bit 1.
+static const uint8_t forward[4] = {0, 2, 3, 1};
+static const uint8_t gray_index[4] = {0, 3, 1, 2};
+
+enum { PROFILE_CONSTANT, PROFILE_RAMP, PROFILE_SINE, PROFILE_WALK, NUM_PROFILES };
+static const char * const profile_names[NUM_PROFILES] = {
+	"constant", "ramp", "sine", "walk"
+};
+
+typedef struct {
+	const char *name;
+	uint8_t  profile;
+	float    speed;		// fastest edges per sample
+	uint32_t samples;
+	uint8_t  reversals;	// direction changes (walk: at random)
+	float    jitter;	// chance per sample of 1 extra edge, either way
+	float    bounce;	// chance per edge of bouncing
+	uint8_t  bounce_max;	// up to this many extra pairs of edges
+	float    drop;		// chance an update (sample or interrupt) is missed
+	uint8_t  interrupts;	// use an Encoder's pin interrupts, not sampling
+	uint8_t  exact;		// must count exactly (fixed scenarios)
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+	// name          profile           speed samples rev jitter bounce max drop  irq exact
+	{"slow",         PROFILE_CONSTANT, 0.25, 100000,  4, 0,     0,     0,  0,    0,  1},
+	{"full speed",   PROFILE_CONSTANT, 1.0,  100000,  4, 0,     0,     0,  0,    0,  1},
+	{"ramp",         PROFILE_RAMP,     1.0,  100000,  6, 0,     0,     0,  0,    0,  1},
+	{"sine",         PROFILE_SINE,     1.0,  100000, 10, 0,     0,     0,  0,    0,  1},
+	{"bounce",       PROFILE_CONSTANT, 0.5,  100000,  2, 0,     0.5,   3,  0,    0,  1},
+	{"jitter",       PROFILE_CONSTANT, 0.1,  100000,  2, 0.2,   0,     0,  0,    0,  0},
+	{"walk",         PROFILE_WALK,     1.0,  100000,  0, 0,     0,     0,  0,    0,  1},
+	{"overspeed",    PROFILE_CONSTANT, 1.6,  100000,  2, 0,     0,     0,  0,    0,  0},
+	{"drops",        PROFILE_SINE,     0.8,  100000,  4, 0,     0,     0,  0.1,  0,  0},
+	{"irq bounce",   PROFILE_RAMP,     4.0,  20000,   6, 0.1,   0.5,   3,  0,    1,  1},
+	{"irq drops",    PROFILE_SINE,     2.0,  20000,   4, 0,     0.2,   2,  0.05, 1,  0},
+};
+#define NUM_SCENARIOS	(sizeof(scenarios) / sizeof(scenarios[0]))
+
+typedef struct {
+	uint32_t exact, cancelled, doubled, reversed, lost;
+	uint32_t updates, no_moves, double_steps;
+	int32_t  truth, model, decoder;
+	uint8_t  safe;		// no interval had more than 1 step
+} result_t;
+
+static uint32_t rng;
+static uint32_t random_u32(void)
+{
+	// xorshift32, so a seed repeats the same run on any machine
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng;
+}
+static float random_float(void)
+{
+	return (random_u32() >> 8) * (1.0f / 16777216.0f);
+}
+
+// What the decoder should count, going from pins old to now.  For a
+// single edge this is also the true count.  At x4, 2 steps (both pins
+// changed) can't be told apart from 2 steps back, and are assumed to
+// be pin1 edges only: +2 when the pins end up equal.  At x1, only pin1
+// edges while pin2 is high count, so jitter cancels.
+static int8_t model_delta(uint8_t old, uint8_t now)
+{
+#if ENCODER_RESOLUTION == 4
+	switch ((gray_index[now] - gray_index[old]) & 3) {
+		case 1: return 1;
+		case 3: return -1;
+		case 2: return ((now & 1) == (now >> 1)) ? 2 : -2;
+	}
+	return 0;
+#elif ENCODER_RESOLUTION == 2
+	if ((now ^ old) & 1) return ((now & 1) == (now >> 1)) ? 1 : -1;
+	return 0;
+#else
+	if (((now ^ old) & 1) && (now & 2)) return (now & 1) ? 1 : -1;
+	return 0;
+#endif
+}
+
+// The edges of one scenario: pins after each edge, which samples (or
+// interrupts) are missed, and where each sample ends.
+typedef struct {
+	uint8_t  *pins;
+	uint8_t  *drop;		// interrupt for this edge is missed
+	uint32_t *sample_end;	// number of edges before the end of each sample
+	uint8_t  *sample_drop;	// update() at the end of this sample is missed
+	uint32_t num_edges, max_edges, num_samples;
+} signal_t;
+
+static void add_edge(signal_t *sig, const scenario_t *sc, int32_t *pos, int dir)
+{
+	if (sig->num_edges >= sig->max_edges) {
+		sig->max_edges = sig->max_edges * 2 + 1024;
+		sig->pins = (uint8_t *)realloc(sig->pins, sig->max_edges);
+		sig->drop = (uint8_t *)realloc(sig->drop, sig->max_edges);
+	}
+	*pos += dir;
+	sig->pins[sig->num_edges] = forward[*pos & 3];
+	sig->drop[sig->num_edges] = (sc->interrupts && random_float() < sc->drop);
+	sig->num_edges++;
+}
+
+// Each real edge bounces with probability sc->bounce: the pin goes
+// back and forth up to bounce_max more times, before it settles.
+static void add_step(signal_t *sig, const scenario_t *sc, int32_t *pos, int dir)
+{
+	add_edge(sig, sc, pos, dir);
+	if (sc->bounce_max && random_float() < sc->bounce) {
+		int n = 1 + random_u32() % sc->bounce_max;
+		while (n--) {
+			add_edge(sig, sc, pos, -dir);
+			add_edge(sig, sc, pos, dir);
+		}
+	}
+}
+
+static float profile_speed(const scenario_t *sc, uint32_t i, float *walk)
+{
+	float t = (float)i / sc->samples;
+	float segments = sc->reversals + 1;
+	float seg = t * segments;
+	int n = (int)seg;
+	float dir = (n & 1) ? -1.0f : 1.0f;
+	switch (sc->profile) {
+	  case PROFILE_CONSTANT:
+		return sc->speed * dir;
+	  case PROFILE_RAMP:
+		// accelerate to full speed, then slow to a stop and reverse
+		return sc->speed * dir * (1.0f - fabsf(2.0f * (seg - n) - 1.0f));
+	  case PROFILE_SINE:
+		return sc->speed * sinf((float)M_PI * seg);
+	  default:
+		*walk += (random_float() - 0.5f) * sc->speed * 0.25f;
+		if (*walk > sc->speed) *walk = sc->speed;
+		if (*walk < -sc->speed) *walk = -sc->speed;
+		return *walk;
+	}
+}
+
+static void generate(signal_t *sig, const scenario_t *sc)
+{
+	float acc = 0, walk = 0;
+	int32_t pos = 0;
+	sig->num_edges = 0;
+	sig->num_samples = sc->samples;
+	sig->sample_end = (uint32_t *)realloc(sig->sample_end, sc->samples * sizeof(uint32_t));
+	sig->sample_drop = (uint8_t *)realloc(sig->sample_drop, sc->samples);
+	for (uint32_t i=0; i < sc->samples; i++) {
+		acc += profile_speed(sc, i, &walk);
+		while (acc >= 1.0f) {
+			add_step(sig, sc, &pos, 1);
+			acc -= 1.0f;
+		}
+		while (acc <= -1.0f) {
+			add_step(sig, sc, &pos, -1);
+			acc += 1.0f;
+		}
+		if (sc->jitter > 0 && random_float() < sc->jitter) {
+			add_step(sig, sc, &pos, (random_u32() & 1) ? 1 : -1);
+		}
+		sig->sample_end[i] = sig->num_edges;
+		sig->sample_drop[i] = (!sc->interrupts && random_float() < sc->drop);
+	}
+}
+
+// Edges [first, end) really happened, starting from pins.
+static int32_t true_count(result_t *r, const signal_t *sig, uint32_t first, uint32_t end,
+	uint8_t pins, uint32_t *counted)
+{
+	int32_t truth = 0, steps = 0;
+	*counted = 0;
+	for (uint32_t e=first; e < end; e++) {
+		int8_t d = model_delta(pins, sig->pins[e]);
+		truth += d;
+		*counted += (d < 0) ? -d : d;
+		steps += (((gray_index[sig->pins[e]] - gray_index[pins]) & 3) == 1) ? 1 : -1;
+		pins = sig->pins[e];
+	}
+	if (steps > 1 || steps < -1) r->safe = 0;
+	r->truth += truth;
+	return truth;
+}
+
+// The decoder looks at the pins once, after edges [first, end), which
+// started from prev, and counts delta.  Classify what it can know,
+// compared to what happened.
+static void observe(result_t *r, const signal_t *sig, uint32_t first, uint32_t end,
+	uint8_t prev, int8_t delta)
+{
+	uint32_t counted;
+	int32_t truth = true_count(r, sig, first, end, prev, &counted);
+	r->updates++;
+	if (delta == 0) r->no_moves++;
+	if (delta == 2 || delta == -2) r->double_steps++;
+	r->model += delta;
+	if (end == first) return;
+	if (delta != truth) {
+		if ((delta > 0 && truth < 0) || (delta < 0 && truth > 0)) {
+			r->reversed++;
+		} else {
+			r->lost++;
+		}
+	} else if (delta == 2 || delta == -2) {
+		r->doubled++;
+	} else if (counted > (uint32_t)((truth < 0) ? -truth : truth)) {
+		r->cancelled++;
+	} else {
+		r->exact++;
+	}
+}
+
+static void init_sampled(Encoder_internal_state_t *enc)
+{
+	memset(enc, 0, sizeof(*enc));
+	enc->pin1_register = PIN_TO_BASEREG(SAMPLED_PIN1);
+	enc->pin2_register = PIN_TO_BASEREG(SAMPLED_PIN2);
+	enc->pin1_bitmask = PIN_TO_BITMASK(SAMPLED_PIN1);
+	enc->pin2_bitmask = PIN_TO_BITMASK(SAMPLED_PIN2);
+	host_gpio[0] &= ~(PIN_TO_BITMASK(SAMPLED_PIN1) | PIN_TO_BITMASK(SAMPLED_PIN2));
+	enc->state = 0;
+}
+
+static inline void set_sampled_pins(uint8_t pins)
+{
+	uint32_t port = host_gpio[0] & ~(PIN_TO_BITMASK(SAMPLED_PIN1) | PIN_TO_BITMASK(SAMPLED_PIN2));
+	if (pins & 1) port |= PIN_TO_BITMASK(SAMPLED_PIN1);
+	if (pins & 2) port |= PIN_TO_BITMASK(SAMPLED_PIN2);
+	host_gpio[0] = port;
+}
+
+// Feed the signal to update(), once per sample.  Returns false if the
+// decoder ever differs from the reference model.
+static bool decode_sampled(const signal_t *sig, result_t *r)
+{
+	Encoder_internal_state_t enc;
+	init_sampled(&enc);
+	uint32_t first = 0;
+	uint8_t old = 0;
+	for (uint32_t i=0; i < sig->num_samples; i++) {
+		if (sig->sample_drop[i]) continue;
+		uint32_t end = sig->sample_end[i];
+		uint8_t now = end ? sig->pins[end - 1] : 0;
+		set_sampled_pins(now);
+		update(&enc);
+		observe(r, sig, first, end, old, model_delta(old, now));
+		if (enc.position != r->model) {
+			printf("  sample %u: decoder %ld, model %ld\n", i,
+				(long)enc.position, (long)r->model);
+			return false;
+		}
+		first = end;
+		old = now;
+	}
+	r->decoder = enc.position;
+#ifdef ENCODER_USE_STATS
+	if (enc.double_steps != r->double_steps || enc.no_moves != r->no_moves) {
+		printf("  stats: double_steps %lu (model %lu), no_moves %lu (model %lu)\n",
+			(unsigned long)enc.double_steps, (unsigned long)r->double_steps,
+			(unsigned long)enc.no_moves, (unsigned long)r->no_moves);
+		return false;
+	}
+#endif
+	return true;
+}
+
+#ifdef ENCODER_USE_INTERRUPTS
+static Encoder *irq_encoder;
+
+// Does pin (0 = pin1) have the encoder's interrupt?  Below x4, only
+// pin1 does.
+static bool irq_fires(uint8_t pin)
+{
+	return ENCODER_RESOLUTION == 4 || pin == 0;
+}
+
+// An edge on the Encoder's pin (0 = pin1), long enough after the
+// last one for ENCODER_GLITCH_FILTER to accept it.
+static void irq_pin_write(uint8_t pin, uint8_t level)
+{
+#ifdef ENCODER_GLITCH_FILTER
+	sim_time += ENCODER_GLITCH_FILTER;
+#endif
+	host_pin_write(pin ? IRQ_PIN2 : IRQ_PIN1, level);
+}
+
+// Start the Encoder at 0 with both pins low.  Missed interrupts in the
+// last run may have left its idea of the pins wrong, so make it see
+// them low.
+static void reset_irq_encoder(void)
+{
+	if (!irq_encoder) irq_encoder = new Encoder(IRQ_PIN1, IRQ_PIN2);
+	host_gpio[0] &= ~(PIN_TO_BITMASK(IRQ_PIN1) | PIN_TO_BITMASK(IRQ_PIN2));
+	irq_pin_write(0, HIGH);
+	irq_pin_write(0, LOW);
+	irq_encoder->write(0);
+}
+
+// Drive the Encoder's pins, edge by edge, so its interrupts run.  A
+// missed interrupt changes the pin without running it, as if it were
+// masked, so the next interrupt sees both edges.
+static bool decode_interrupts(const signal_t *sig, result_t *r)
+{
+	reset_irq_encoder();
+#ifdef ENCODER_USE_STATS
+	Encoder_stats_t before = irq_encoder->stats();
+#endif
+	uint32_t first = 0, e = 0;
+	uint8_t old = 0, pins = 0;
+	for (uint32_t i=0; i < sig->num_samples; i++) {
+		for (; e < sig->sample_end[i]; e++) {
+			uint8_t now = sig->pins[e];
+			uint8_t pin = ((now ^ pins) & 1) ? 0 : 1;
+			uint8_t level = (now >> pin) & 1;
+			uint32_t mask = PIN_TO_BITMASK(pin ? IRQ_PIN2 : IRQ_PIN1);
+			pins = now;
+			if (!irq_fires(pin) || sig->drop[e]) {
+				host_gpio[0] = (host_gpio[0] & ~mask) | (level ? mask : 0);
+				continue;
+			}
+			irq_pin_write(pin, level);
+			observe(r, sig, first, e + 1, old, model_delta(old, now));
+			first = e + 1;
+			old = now;
+		}
+		int32_t position = irq_encoder->read();
+		if (position != r->model) {
+			printf("  sample %u: decoder %ld, model %ld\n", i,
+				(long)position, (long)r->model);
+			return false;
+		}
+	}
+	// edges after the last interrupt are real, but not seen yet
+	uint32_t counted;
+	if (true_count(r, sig, first, e, old, &counted) || counted) r->safe = 0;
+	r->decoder = irq_encoder->read();
+#ifdef ENCODER_USE_STATS
+	Encoder_stats_t after = irq_encoder->stats();
+	uint32_t double_steps = after.double_steps - before.double_steps;
+	uint32_t no_moves = after.no_moves - before.no_moves;
+	if (double_steps != r->double_steps || no_moves != r->no_moves) {
+		printf("  stats: double_steps %lu (model %lu), no_moves %lu (model %lu)\n",
+			(unsigned long)double_steps, (unsigned long)r->double_steps,
+			(unsigned long)no_moves, (unsigned long)r->no_moves);
+		return false;
+	}
+#endif
+	return true;
+}
+
+#ifdef ENCODER_GLITCH_FILTER
+// Real edges, far enough apart, some followed by contact bounce, and
+// noise spikes, where a pin flips and returns in less time than
+// ENCODER_GLITCH_FILTER.  The filter accepts the first edge of each
+// burst and rejects the rest, so when a spike's return is rejected,
+// read() must check the pins itself to get back to the settled count.
+static bool check_glitch_filter(void)
+{
+	reset_irq_encoder();
+	rng = 1;
+	uint8_t pins = 0;	// settled
+	int32_t expect = 0;
+	uint32_t rejected = irq_encoder->rejectedEdges(), spikes = 0, bounces = 0;
+	uint32_t irqs = 0;
+#ifdef ENCODER_ISR_INSTRUMENTATION
+	irq_encoder->resetIsrStats();
+#endif
+	for (uint32_t n=0; n < 100000; n++) {
+		uint8_t pin = random_u32() & 1;
+		uint8_t flip = pins ^ (1 << pin);
+		irq_pin_write(pin, (flip >> pin) & 1);
+		uint32_t writes = 1;
+		if (random_u32() & 3) {
+			// a real edge, which may bounce, all in the same tick
+			expect += model_delta(pins, flip);
+			pins = flip;
+			for (uint32_t b = random_u32() % 4; b > 0; b--) {
+				host_pin_write(pin ? IRQ_PIN2 : IRQ_PIN1, !((pins >> pin) & 1));
+				host_pin_write(pin ? IRQ_PIN2 : IRQ_PIN1, (pins >> pin) & 1);
+				bounces++;
+				writes += 2;
+			}
+		} else {
+			host_pin_write(pin ? IRQ_PIN2 : IRQ_PIN1, (pins >> pin) & 1);
+			spikes++;
+			writes++;
+		}
+		if (irq_fires(pin)) irqs += writes;
+		int32_t got = irq_encoder->read();
+		if (got != expect) {
+			printf("  glitch filter, edge %u: read %ld, expected %ld\n", n,
+				(long)got, (long)expect);
+			return false;
+		}
+#ifdef ENCODER_USE_STATS
+		// with nothing rejected since, read() doesn't need the pins,
+		// so it must not call update(), which would count a no_move
+		uint32_t no_moves = irq_encoder->stats().no_moves;
+		irq_encoder->read();
+		if (irq_encoder->stats().no_moves != no_moves) {
+			printf("  glitch filter: read() polled with no rejected edge\n");
+			return false;
+		}
+#endif
+	}
+	rejected = irq_encoder->rejectedEdges() - rejected;
+	printf("glitch filter  %u interrupts, %u spikes, %u bounces, %u edges rejected  %s\n",
+		irqs, spikes, bounces, rejected, rejected ? "ok" : "FAIL");
+#ifdef ENCODER_ISR_INSTRUMENTATION
+	// rejected edges are still interrupts
+	if (irq_encoder->isrStats().count != irqs) {
+		printf("  glitch filter: isrStats().count %lu, expected %u\n",
+			(unsigned long)irq_encoder->isrStats().count, irqs);
+		return false;
+	}
+#endif
+	return rejected != 0;
+}
+#endif
+#endif
+
+static signal_t sig;
+
+// Run one scenario and check every property.  Returns false on failure.
+static bool check(const scenario_t *sc, bool verbose)
+{
+	result_t r;
+	memset(&r, 0, sizeof(r));
+	r.safe = 1;
+	generate(&sig, sc);
+	bool ok;
+	if (sc->interrupts) {
+#ifdef ENCODER_USE_INTERRUPTS
+		ok = decode_interrupts(&sig, &r);
+#else
+		if (verbose) printf("%-12s  skipped, needs interrupts\n", sc->name);
+		return true;
+#endif
+	} else {
+		ok = decode_sampled(&sig, &r);
+	}
+	if (ok && r.decoder != r.truth && (r.safe || sc->exact)) {
+		printf("  count %ld, true position %ld, with no interval over 1 step\n",
+			(long)r.decoder, (long)r.truth);
+		ok = false;
+	}
+	if (verbose || !ok) {
+		printf("%-12s %8u edges  exact %7u  cancelled %6u  double %6u  "
+			"reversed %5u  lost %5u  error %6ld  %s\n",
+			sc->name, sig.num_edges, r.exact, r.cancelled, r.doubled,
+			r.reversed, r.lost, (long)(r.decoder - r.truth), ok ? "ok" : "FAIL");
+	}
+	return ok;
+}
+
+static void random_scenario(scenario_t *sc, uint32_t seed)
+{
+	rng = seed ? seed : 1;
+	memset(sc, 0, sizeof(*sc));
+	sc->name = "random";
+	sc->profile = random_u32() % NUM_PROFILES;
+	sc->speed = random_float() * ((random_u32() & 1) ? 1.0f : 3.0f);
+	sc->samples = 100 + random_u32() % 5000;
+	sc->reversals = random_u32() % 16;
+	if (random_u32() & 1) sc->jitter = random_float() * 0.3f;
+	if (random_u32() & 1) {
+		sc->bounce = random_float();
+		sc->bounce_max = 1 + random_u32() % 4;
+	}
+	if (random_u32() & 1) sc->drop = random_float() * 0.2f;
+	sc->interrupts = random_u32() & 1;
+}
+
+static void print_scenario(const scenario_t *sc, uint32_t seed)
+{
+	printf("  seed %u: %s, speed %.3f, %u samples, %u reversals, jitter %.3f, "
+		"bounce %.3f x%u, drop %.3f, %s\n", seed, profile_names[sc->profile],
+		sc->speed, sc->samples, sc->reversals, sc->jitter, sc->bounce,
+		sc->bounce_max, sc->drop, sc->interrupts ? "interrupts" : "sampled");
+}
+
+static double now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// How fast update() decodes each sampled scenario.
+static void throughput(void)
+{
+	printf("update() throughput, best of %d\n", NUM_RUNS);
+	for (uint32_t n=0; n < NUM_SCENARIOS; n++) {
+		const scenario_t *sc = &scenarios[n];
+		if (sc->interrupts) continue;
+		rng = n + 1;
+		generate(&sig, sc);
+		uint8_t *samples = (uint8_t *)malloc(sc->samples);
+		for (uint32_t i=0; i < sc->samples; i++) {
+			samples[i] = sig.sample_end[i] ? sig.pins[sig.sample_end[i] - 1] : 0;
+		}
+		double best = 1e30;
+		for (int run=0; run < NUM_RUNS; run++) {
+			Encoder_internal_state_t enc;
+			init_sampled(&enc);
+			double t = now_ns();
+			for (uint32_t i=0; i < sc->samples; i++) {
+				set_sampled_pins(samples[i]);
+				update(&enc);
+			}
+			t = now_ns() - t;
+			if (t < best) best = t;
+		}
+		printf("%-12s  %6.2f ns/sample  %8.1f Msamples/s  %8.1f Medges/s\n",
+			sc->name, best / sc->samples, sc->samples * 1e3 / best,
+			sig.num_edges * 1e3 / best);
+		free(samples);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t runs = 1000, seed = 0;
+	bool one = false;
+	for (int i=1; i < argc; i++) {
+		if (!strcmp(argv[i], "-t")) {
+			throughput();
+			return 0;
+		} else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+			runs = strtoul(argv[++i], NULL, 0);
+		} else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+			seed = strtoul(argv[++i], NULL, 0);
+			one = true;
+		} else {
+			printf("usage: %s [-t] [-n runs] [-s seed]\n", argv[0]);
+			return 2;
+		}
+	}
+	scenario_t sc;
+	if (one) {
+		random_scenario(&sc, seed);
+		print_scenario(&sc, seed);
+		return check(&sc, true) ? 0 : 1;
+	}
+
+	printf("Encoder decoder simulation, resolution x%d\n", ENCODER_RESOLUTION);
+	uint32_t failed = 0;
+#if defined(ENCODER_GLITCH_FILTER) && defined(ENCODER_USE_INTERRUPTS)
+	if (!check_glitch_filter()) failed++;
+#endif
+	for (uint32_t n=0; n < NUM_SCENARIOS; n++) {
+		rng = n + 1;
+		if (!check(&scenarios[n], true)) failed++;
+	}
+	for (uint32_t n=1; n <= runs; n++) {
+		random_scenario(&sc, n);
+		if (!check(&sc, false)) {
+			print_scenario(&sc, n);
+			failed++;
+		}
+	}
+	printf("%u random runs, %u failed\n", runs, failed);
+	return failed ? 1 : 0;
+}
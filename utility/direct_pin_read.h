@@ -7,6 +7,7 @@
 #define PIN_TO_BASEREG(pin)             (portInputRegister(digitalPinToPort(pin)))
 #define PIN_TO_BITMASK(pin)             (digitalPinToBitMask(pin))
 #define DIRECT_PIN_READ(base, mask)     (((*(base)) & (mask)) ? 1 : 0)
+#define DIRECT_PORT_READ(base)          (*(base))
 
 #elif defined(TEENSYDUINO) && (defined(KINETISK) || defined(KINETISL))
 
@@ -14,6 +15,7 @@
 #define PIN_TO_BASEREG(pin)             (portInputRegister(digitalPinToPort(pin)))
 #define PIN_TO_BITMASK(pin)             (digitalPinToBitMask(pin))
 #define DIRECT_PIN_READ(base, mask)     (((*(base)) & (mask)) ? 1 : 0)
+#define DIRECT_PORT_READ(base)          (*(base))
 
 #elif defined(__IMXRT1052__) || defined(__IMXRT1062__)
 
@@ -21,6 +23,7 @@
 #define PIN_TO_BASEREG(pin)             (portOutputRegister(pin))
 #define PIN_TO_BITMASK(pin)             (digitalPinToBitMask(pin))
 #define DIRECT_PIN_READ(base, mask)     (((*(base)) & (mask)) ? 1 : 0)
+#define DIRECT_PORT_READ(base)          (*(base))
 
 #elif defined(__SAM3X8E__)  // || defined(ESP8266)
 
@@ -28,6 +31,7 @@
 #define PIN_TO_BASEREG(pin)             (portInputRegister(digitalPinToPort(pin)))
 #define PIN_TO_BITMASK(pin)             (digitalPinToBitMask(pin))
 #define DIRECT_PIN_READ(base, mask)     (((*(base)) & (mask)) ? 1 : 0)
+#define DIRECT_PORT_READ(base)          (*(base))
 
 #elif defined(__PIC32MX__)
 
@@ -35,6 +39,7 @@
 #define PIN_TO_BASEREG(pin)             (portModeRegister(digitalPinToPort(pin)))
 #define PIN_TO_BITMASK(pin)             (digitalPinToBitMask(pin))
 #define DIRECT_PIN_READ(base, mask)	(((*(base+4)) & (mask)) ? 1 : 0)
+#define DIRECT_PORT_READ(base)          (*((base)+4))
 
 /* ESP8266 v2.0.0 Arduino workaround for bug https://github.com/esp8266/Arduino/issues/1110 */
 #elif defined(ESP8266)
@@ -43,6 +48,7 @@
 #define PIN_TO_BASEREG(pin)             ((volatile uint32_t *)(0x60000000+(0x318)))
 #define PIN_TO_BITMASK(pin)             (digitalPinToBitMask(pin))
 #define DIRECT_PIN_READ(base, mask)     (((*(base)) & (mask)) ? 1 : 0)
+#define DIRECT_PORT_READ(base)          (*(base))
 
 /* ESP32  Arduino (https://github.com/espressif/arduino-esp32) */
 #elif defined(ESP32)
@@ -51,6 +57,7 @@
 #define PIN_TO_BASEREG(pin)             (portInputRegister(digitalPinToPort(pin)))
 #define PIN_TO_BITMASK(pin)             (digitalPinToBitMask(pin))
 #define DIRECT_PIN_READ(base, mask)     (((*(base)) & (mask)) ? 1 : 0)
+#define DIRECT_PORT_READ(base)          (*(base))
 
 #elif defined(__SAMD21G18A__) || defined(__SAMD51__)
 
@@ -58,6 +65,7 @@
 #define PIN_TO_BASEREG(pin)             portModeRegister(digitalPinToPort(pin))
 #define PIN_TO_BITMASK(pin)             (digitalPinToBitMask(pin))
 #define DIRECT_PIN_READ(base, mask)     (((*((base)+8)) & (mask)) ? 1 : 0)
+#define DIRECT_PORT_READ(base)          (*((base)+8))
 
 #elif defined(RBL_NRF51822)
 
@@ -92,6 +100,15 @@ IO_REG_TYPE directRead(volatile IO_REG_TYPE *base, IO_REG_TYPE pin)
 }
 #define DIRECT_PIN_READ(base, pin)      directRead(base, pin)
 
+/* Host (Linux) builds, see extras/host/Arduino.h */
+#elif defined(ENCODER_HOST_BUILD)
+
+#define IO_REG_TYPE			uint32_t
+#define PIN_TO_BASEREG(pin)             (portInputRegister(digitalPinToPort(pin)))
+#define PIN_TO_BITMASK(pin)             (digitalPinToBitMask(pin))
+#define DIRECT_PIN_READ(base, mask)     (((*(base)) & (mask)) ? 1 : 0)
+#define DIRECT_PORT_READ(base)          (*(base))
+
 #endif
 
 #endif
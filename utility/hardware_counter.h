@@ -0,0 +1,81 @@
+#ifndef hardware_counter_h_
+#define hardware_counter_h_
+
+// Quadrature counting by a hardware peripheral, for
+// ENCODER_USE_HARDWARE_COUNTER.  Each backend defines
+// ENCODER_HARDWARE_COUNTER and provides:
+//
+//   Encoder_hw_counter_t              state for 1 counter
+//   encoder_hw_begin(hw, pin1, pin2)  true if these pins got a counter
+//   encoder_hw_count(hw)              count since begin, 32 bits, with
+//                                     the same sign as update()
+//
+// When begin fails (no free counter, or pins it can't route), Encoder
+// uses interrupts or polling as usual.  The only backend is ESP32 PCNT,
+// on every other board this file defines nothing, and the option is
+// ignored.  extras/host/pcnt.cpp checks it against a fake driver.
+
+#if defined(ESP32) && defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+#include "soc/soc_caps.h"
+#if SOC_PCNT_SUPPORTED
+#include "driver/pulse_cnt.h"
+#define ENCODER_HARDWARE_COUNTER
+
+// ESP32 PCNT, using the ESP-IDF 5 driver.  Any GPIO can be routed to
+// a unit, so this only fails when all units are taken.  The unit only
+// counts 16 bits, but with accum_count the driver adds each overflow
+// into a software total, which pcnt_unit_get_count() includes.  Each
+// channel counts both edges of one pin, and the other pin's level
+// sets the direction, so all 4 edges of each cycle are counted.
+typedef pcnt_unit_handle_t Encoder_hw_counter_t;
+
+static bool encoder_hw_begin(Encoder_hw_counter_t *hw, uint8_t pin1, uint8_t pin2) {
+	pcnt_unit_config_t unit_config = {};
+	unit_config.low_limit = -32768;
+	unit_config.high_limit = 32767;
+	unit_config.flags.accum_count = 1;
+	pcnt_unit_handle_t unit = NULL;
+	if (pcnt_new_unit(&unit_config, &unit) != ESP_OK) return false;
+	pcnt_channel_handle_t chan1 = NULL, chan2 = NULL;
+	pcnt_chan_config_t chan1_config = {};
+	chan1_config.edge_gpio_num = pin1;
+	chan1_config.level_gpio_num = pin2;
+	pcnt_chan_config_t chan2_config = {};
+	chan2_config.edge_gpio_num = pin2;
+	chan2_config.level_gpio_num = pin1;
+	if (pcnt_new_channel(unit, &chan1_config, &chan1) != ESP_OK
+	  || pcnt_new_channel(unit, &chan2_config, &chan2) != ESP_OK
+	  // pin1 rising while pin2 is high is +1, same as update()
+	  || pcnt_channel_set_edge_action(chan1, PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+		PCNT_CHANNEL_EDGE_ACTION_DECREASE) != ESP_OK
+	  || pcnt_channel_set_level_action(chan1, PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+		PCNT_CHANNEL_LEVEL_ACTION_INVERSE) != ESP_OK
+	  // pin2 rising while pin1 is high is -1
+	  || pcnt_channel_set_edge_action(chan2, PCNT_CHANNEL_EDGE_ACTION_DECREASE,
+		PCNT_CHANNEL_EDGE_ACTION_INCREASE) != ESP_OK
+	  || pcnt_channel_set_level_action(chan2, PCNT_CHANNEL_LEVEL_ACTION_KEEP,
+		PCNT_CHANNEL_LEVEL_ACTION_INVERSE) != ESP_OK
+	  || pcnt_unit_add_watch_point(unit, unit_config.low_limit) != ESP_OK
+	  || pcnt_unit_add_watch_point(unit, unit_config.high_limit) != ESP_OK
+	  || pcnt_unit_enable(unit) != ESP_OK
+	  || pcnt_unit_clear_count(unit) != ESP_OK
+	  || pcnt_unit_start(unit) != ESP_OK) {
+		if (chan2) pcnt_del_channel(chan2);
+		if (chan1) pcnt_del_channel(chan1);
+		pcnt_del_unit(unit);
+		return false;
+	}
+	*hw = unit;
+	return true;
+}
+
+static inline int32_t encoder_hw_count(Encoder_hw_counter_t *hw) {
+	int count = 0;
+	pcnt_unit_get_count(*hw, &count);
+	return count;
+}
+
+#endif // SOC_PCNT_SUPPORTED
+#endif
+
+#endif
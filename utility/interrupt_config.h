@@ -3,7 +3,7 @@
 #include <avr/io.h>
 #include <avr/interrupt.h>
 
-#define attachInterrupt(num, func, mode) enableInterrupt(num)
+#define attachInterrupt(num, func, mode) enableInterrupt(num, mode)
 #if defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__)
 #define SCRAMBLE_INT_ORDER(num) ((num < 4) ? num + 2 : ((num < 6) ? num - 4 : num))
 #define DESCRAMBLE_INT_ORDER(num) ((num < 2) ? num + 4 : ((num < 6) ? num - 2 : num))
@@ -12,24 +12,25 @@
 #define DESCRAMBLE_INT_ORDER(num) (num)
 #endif
 
-static void enableInterrupt(uint8_t num)
+// mode is CHANGE or RISING, which are also the ISCn1:0 bits
+static void enableInterrupt(uint8_t num, uint8_t mode)
 {
 	switch (DESCRAMBLE_INT_ORDER(num)) {
 		#if defined(EICRA) && defined(EIMSK)
 		case 0:
-			EICRA = (EICRA & 0xFC) | 0x01;
+			EICRA = (EICRA & 0xFC) | mode;
 			EIMSK |= 0x01;
 			return;
 		case 1:
-			EICRA = (EICRA & 0xF3) | 0x04;
+			EICRA = (EICRA & 0xF3) | (mode << 2);
 			EIMSK |= 0x02;
 			return;
 		case 2:
-			EICRA = (EICRA & 0xCF) | 0x10;
+			EICRA = (EICRA & 0xCF) | (mode << 4);
 			EIMSK |= 0x04;
 			return;
 		case 3:
-			EICRA = (EICRA & 0x3F) | 0x40;
+			EICRA = (EICRA & 0x3F) | (mode << 6);
 			EIMSK |= 0x08;
 			return;
 		#elif defined(MCUCR) && defined(GICR)
@@ -53,19 +54,19 @@ static void enableInterrupt(uint8_t num)
 		#endif
 		#if defined(EICRB) && defined(EIMSK)
 		case 4:
-			EICRB = (EICRB & 0xFC) | 0x01;
+			EICRB = (EICRB & 0xFC) | mode;
 			EIMSK |= 0x10;
 			return;
 		case 5:
-			EICRB = (EICRB & 0xF3) | 0x04;
+			EICRB = (EICRB & 0xF3) | (mode << 2);
 			EIMSK |= 0x20;
 			return;
 		case 6:
-			EICRB = (EICRB & 0xCF) | 0x10;
+			EICRB = (EICRB & 0xCF) | (mode << 4);
 			EIMSK |= 0x40;
 			return;
 		case 7:
-			EICRB = (EICRB & 0x3F) | 0x40;
+			EICRB = (EICRB & 0x3F) | (mode << 6);
 			EIMSK |= 0x80;
 			return;
 		#endif
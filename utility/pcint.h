@@ -0,0 +1,115 @@
+#ifndef pcint_h_
+#define pcint_h_
+
+// Pin change interrupts for ENCODER_USE_PCINT, on AVR.  Pins come in
+// groups of up to 8 (usually 1 port) which share 1 interrupt vector,
+// and each group keeps a list of the encoders with a pin in it.  When
+// any pin in the group changes, its vector reads the port once and
+// only calls isr_update() for encoders whose pins differ from their
+// state, so every other encoder on that port costs just a few cycles.
+// The encoders which moved are decoded by update(), as usual (the
+// assembly version, unless options need the C one).
+//
+// Pin change interrupts always fire on both edges.  At ENCODER_RESOLUTION
+// 1, only pin1 is enabled, and the falling edge counts back while pin2
+// is high, so jitter across the rising edge cancels.
+//
+// This defines the PCINTn_vect functions, so it can't be used together
+// with SoftwareSerial or other libraries which also define them.
+//
+// extras/host/pcint.cpp checks it on a fake ATmega328P.
+
+#if defined(__AVR__) && defined(PCICR) && defined(digitalPinToPCICR)
+#define ENCODER_PCINT
+
+#if defined(PCINT3_vect)
+#define ENCODER_PCINT_GROUPS	4
+#elif defined(PCINT2_vect)
+#define ENCODER_PCINT_GROUPS	3
+#elif defined(PCINT1_vect)
+#define ENCODER_PCINT_GROUPS	2
+#else
+#define ENCODER_PCINT_GROUPS	1
+#endif
+
+// Encoders per group.  An Uno has 3 groups: pins 8-13, A0-A5 and 0-7.
+#ifndef ENCODER_PCINT_MAX_PER_GROUP
+#define ENCODER_PCINT_MAX_PER_GROUP	4
+#endif
+
+typedef struct {
+	Encoder_internal_state_t * list[ENCODER_PCINT_MAX_PER_GROUP];
+	volatile uint8_t           count;
+} Encoder_pcint_group_t;
+
+static Encoder_pcint_group_t encoder_pcint[ENCODER_PCINT_GROUPS];
+
+// Enable pin's pin change interrupt, to update state.  Returns 0 if the
+// pin has none, or its group is full.
+static uint8_t encoder_pcint_attach(uint8_t pin, Encoder_internal_state_t *state) {
+	volatile uint8_t *pcicr = digitalPinToPCICR(pin);
+	if (!pcicr) return 0;
+	uint8_t group = digitalPinToPCICRbit(pin);
+	if (group >= ENCODER_PCINT_GROUPS) return 0;
+	Encoder_pcint_group_t *g = &encoder_pcint[group];
+	uint8_t i = 0;
+	while (i < g->count && g->list[i] != state) i++;
+	if (i == g->count) {
+		if (i >= ENCODER_PCINT_MAX_PER_GROUP) return 0;
+		// the vector may run any time, so the entry must be
+		// complete before count includes it
+		g->list[i] = state;
+		g->count = i + 1;
+	}
+	*digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+	*pcicr |= _BV(group);
+	return 1;
+}
+
+// Disable pin's pin change interrupt.  The encoder stays in its group's
+// list, so attaching again is cheap.  Call with interrupts disabled.
+static inline void encoder_pcint_detach(uint8_t pin) {
+	if (!digitalPinToPCICR(pin)) return;
+	*digitalPinToPCMSK(pin) &= ~_BV(digitalPinToPCMSKbit(pin));
+}
+
+static inline void encoder_pcint_update(Encoder_pcint_group_t *g) {
+	volatile uint8_t *reg = NULL;
+	uint8_t port = 0;
+	uint8_t count = g->count;
+	for (uint8_t i=0; i < count; i++) {
+		Encoder_internal_state_t *arg = g->list[i];
+		if (arg->pin1_register != reg) {
+			reg = arg->pin1_register;
+			port = *reg;
+		}
+		uint8_t pins = (port & arg->pin1_bitmask) ? 1 : 0;
+#if ENCODER_RESOLUTION == 4
+		uint8_t port2 = (arg->pin2_register == reg) ? port : *arg->pin2_register;
+		if (port2 & arg->pin2_bitmask) pins |= 2;
+		uint8_t moved = (pins ^ arg->state) & 3;
+#else
+		// only pin1 counts, other pins on this port don't matter
+		uint8_t moved = (pins ^ arg->state) & 1;
+#endif
+#ifdef ENCODER_USE_INDEX
+		if (arg->index_register && DIRECT_PIN_READ(arg->index_register,
+		  arg->index_bitmask) != arg->index_level) moved = 1;
+#endif
+		if (moved) isr_update(arg);
+	}
+}
+
+ISR(PCINT0_vect) { encoder_pcint_update(&encoder_pcint[0]); }
+#if ENCODER_PCINT_GROUPS > 1
+ISR(PCINT1_vect) { encoder_pcint_update(&encoder_pcint[1]); }
+#endif
+#if ENCODER_PCINT_GROUPS > 2
+ISR(PCINT2_vect) { encoder_pcint_update(&encoder_pcint[2]); }
+#endif
+#if ENCODER_PCINT_GROUPS > 3
+ISR(PCINT3_vect) { encoder_pcint_update(&encoder_pcint[3]); }
+#endif
+
+#endif // __AVR__ && PCICR
+#endif